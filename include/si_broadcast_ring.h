@@ -0,0 +1,264 @@
+#ifndef SI_BROADCAST_RING_H
+#define SI_BROADCAST_RING_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <immintrin.h> // for _mm_pause
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+
+namespace si {
+
+// Wait strategies for broadcast_ring, they decide what a producer waiting for
+// space or a consumer waiting for events does in the meantime.
+// wait(ready) returns once ready() is true, notify() is called after every
+// change that can make ready() true for someone.
+
+// Lowest latency, but burns a core per waiting thread.
+// Only makes sense when every thread has its own core.
+struct busy_spin_wait
+{
+    template <typename F>
+    void wait(F ready)
+    {
+        while (!ready())
+            _mm_pause();
+    }
+
+    void notify() noexcept
+    {}
+};
+
+// Spins for a short while, then lets other threads run.
+struct yielding_wait
+{
+    template <typename F>
+    void wait(F ready)
+    {
+        for (unsigned i = 0; !ready(); ++ i)
+        {
+            if (i < spin_count)
+                _mm_pause();
+            else
+                std::this_thread::yield();
+        }
+    }
+
+    void notify() noexcept
+    {}
+
+    static constexpr unsigned spin_count = 64;
+};
+
+// Spins for a short while, then sleeps on a condition variable.
+// Notifying only takes the mutex when a thread is asleep.
+struct blocking_wait
+{
+    template <typename F>
+    void wait(F ready)
+    {
+        for (unsigned i = 0; i < spin_count; ++ i)
+        {
+            if (ready())
+                return;
+            _mm_pause();
+        }
+
+        std::unique_lock<std::mutex> ulock(d_mutex);
+        // Pairs with the fence in notify(): either we see the change,
+        // or the notifier sees us waiting.
+        d_waiters.fetch_add(1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        d_cond.wait(ulock, ready);
+        d_waiters.fetch_sub(1, std::memory_order_relaxed);
+    }
+
+    void notify()
+    {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (d_waiters.load(std::memory_order_relaxed) == 0)
+            return;
+
+        { std::lock_guard<std::mutex> guard(d_mutex); }
+        d_cond.notify_all();
+    }
+
+    static constexpr unsigned spin_count = 64;
+
+    std::mutex              d_mutex;
+    std::condition_variable d_cond;
+    std::atomic<unsigned>   d_waiters{0};
+};
+
+// Single-producer broadcast ring buffer in the style of the LMAX Disruptor.
+// https://lmax-exchange.github.io/disruptor/disruptor.html
+//
+// Unlike spmc_fifo_queue, where each element goes to one consumer, every
+// consumer sees every event, in order.
+// - the slots are preallocated and reused, the producer writes the events in place
+// - the producer publishes events by advancing its cursor
+// - each consumer has its own sequence: the number of events it consumed
+// - the producer never gets more than capacity events ahead of the slowest
+//   consumer (gating), so it never overwrites an event that wasn't read by all
+// - consumers process all the available events in a batch and only then
+//   advance their sequence
+// All the sequences are on their own cache lines.
+template <class T, class WaitStrategy = yielding_wait>
+class broadcast_ring
+{
+public:
+    // The capacity is rounded up to a power of two.
+    broadcast_ring(size_t capacity, size_t num_consumers)
+        : d_mask(round_up(capacity) - 1)
+        , d_slots(new T[d_mask + 1])
+        , d_consumers(new sequence[num_consumers])
+        , d_num_consumers(num_consumers)
+    {
+        if (num_consumers == 0)
+            throw std::invalid_argument("There must be at least one consumer.");
+    }
+
+    broadcast_ring(const broadcast_ring&) = delete;
+    broadcast_ring& operator= (const broadcast_ring&) = delete;
+
+    // Producer only. Waits for space, then calls fill(T&) on the next slot
+    // and publishes it.
+    template <typename F>
+    void publish_with(F fill)
+    {
+        const size_t seq = d_next;
+        if (!has_space(seq))
+            d_wait.wait([this, seq]() { return has_space(seq); });
+        publish(seq, fill);
+    }
+
+    void publish(const T& val)
+    {
+        publish_with([&val](T& slot) { slot = val; });
+    }
+
+    // Producer only. Returns false if the slowest consumer is capacity events behind.
+    template <typename F>
+    bool try_publish_with(F fill)
+    {
+        const size_t seq = d_next;
+        if (!has_space(seq))
+            return false;
+
+        publish(seq, fill);
+        return true;
+    }
+
+    bool try_publish(const T& val)
+    {
+        return try_publish_with([&val](T& slot) { slot = val; });
+    }
+
+    // Consumer only. Waits for events, then calls f(const T&) on all the
+    // available ones and returns how many there were.
+    template <typename F>
+    size_t consume(size_t consumer, F f)
+    {
+        const size_t next = d_consumers[consumer].value.load(std::memory_order_relaxed);
+        size_t available = d_cursor.load(std::memory_order_acquire);
+        if (available == next)
+        {
+            d_wait.wait([this, next, &available]() {
+                available = d_cursor.load(std::memory_order_acquire);
+                return available != next;
+            });
+        }
+        return consume(consumer, next, available, f);
+    }
+
+    // Consumer only. Same as consume, but returns 0 right away if there are no events.
+    template <typename F>
+    size_t try_consume(size_t consumer, F f)
+    {
+        const size_t next = d_consumers[consumer].value.load(std::memory_order_relaxed);
+        const size_t available = d_cursor.load(std::memory_order_acquire);
+        if (available == next)
+            return 0;
+        return consume(consumer, next, available, f);
+    }
+
+    size_t capacity() const noexcept
+    {
+        return d_mask + 1;
+    }
+
+    size_t num_consumers() const noexcept
+    {
+        return d_num_consumers;
+    }
+
+private:
+    struct alignas(64) sequence
+    {
+        std::atomic<size_t> value{0};
+    };
+
+    static size_t round_up(size_t capacity) noexcept
+    {
+        size_t res = 1;
+        while (res < capacity)
+            res <<= 1;
+        return res;
+    }
+
+    // Only rescans the consumer sequences when the cached minimum says the ring is full.
+    bool has_space(size_t seq) noexcept
+    {
+        if (seq - d_cached_gating <= d_mask)
+            return true;
+
+        size_t gating = seq;
+        for (size_t i = 0; i < d_num_consumers; ++ i)
+        {
+            const size_t consumed = d_consumers[i].value.load(std::memory_order_acquire);
+            if (consumed < gating)
+                gating = consumed;
+        }
+        d_cached_gating = gating;
+        return seq - gating <= d_mask;
+    }
+
+    template <typename F>
+    void publish(size_t seq, F& fill)
+    {
+        fill(d_slots[seq & d_mask]);
+        d_next = seq + 1;
+        d_cursor.store(seq + 1, std::memory_order_release);
+        d_wait.notify();
+    }
+
+    template <typename F>
+    size_t consume(size_t consumer, size_t next, size_t available, F& f)
+    {
+        for (size_t seq = next; seq != available; ++ seq)
+            f(static_cast<const T&>(d_slots[seq & d_mask]));
+
+        d_consumers[consumer].value.store(available, std::memory_order_release);
+        d_wait.notify();
+        return available - next;
+    }
+
+    // Read-only after construction, shared by everyone.
+    const size_t                d_mask;
+    std::unique_ptr<T[]>        d_slots;
+    std::unique_ptr<sequence[]> d_consumers;
+    const size_t                d_num_consumers;
+    WaitStrategy                d_wait;
+
+    // Producer side, the cursor is read by the consumers.
+    alignas(64) std::atomic<size_t> d_cursor{0};
+    alignas(64) size_t              d_next = 0;
+    size_t                          d_cached_gating = 0;
+};
+
+} // namespace si
+
+#endif
@@ -0,0 +1,401 @@
+#ifndef SI_COROUTINE_H
+#define SI_COROUTINE_H
+
+#include <coroutine>
+#include <exception>
+#include <future>
+#include <optional>
+#include <type_traits>
+#include <utility>
+#include <variant>
+
+namespace si {
+
+// Coroutines that run on an executor: any object with a post(f) member that
+// runs f() on some thread later, like thread_pool.
+
+template <typename T = void>
+class task;
+
+template <typename T>
+struct task_promise;
+
+// What task_promise<T> and task_promise<void> have in common.
+struct task_promise_base
+{
+    // Resumes whoever awaits the task when it finishes.
+    struct final_awaiter
+    {
+        bool await_ready() const noexcept
+        {
+            return false;
+        }
+
+        template <typename Promise>
+        std::coroutine_handle<> await_suspend(std::coroutine_handle<Promise> h) noexcept
+        {
+            const std::coroutine_handle<> cont = h.promise().continuation;
+            return cont ? cont : std::noop_coroutine();
+        }
+
+        void await_resume() const noexcept
+        {}
+    };
+
+    // Lazy, the task starts when it's awaited.
+    std::suspend_always initial_suspend() const noexcept
+    {
+        return {};
+    }
+
+    final_awaiter final_suspend() const noexcept
+    {
+        return {};
+    }
+
+    std::coroutine_handle<> continuation;
+};
+
+template <typename T>
+struct task_promise : task_promise_base
+{
+    task<T> get_return_object() noexcept;
+
+    template <typename U>
+    void return_value(U&& val)
+    {
+        result.template emplace<1>(std::forward<U>(val));
+    }
+
+    void unhandled_exception() noexcept
+    {
+        result.template emplace<2>(std::current_exception());
+    }
+
+    T get()
+    {
+        if (result.index() == 2)
+            std::rethrow_exception(std::get<2>(result));
+        return std::move(std::get<1>(result));
+    }
+
+    std::variant<std::monostate, T, std::exception_ptr> result;
+};
+
+template <>
+struct task_promise<void> : task_promise_base
+{
+    task<void> get_return_object() noexcept;
+
+    void return_void() noexcept
+    {}
+
+    void unhandled_exception() noexcept
+    {
+        error = std::current_exception();
+    }
+
+    void get()
+    {
+        if (error)
+            std::rethrow_exception(error);
+    }
+
+    std::exception_ptr error;
+};
+
+// Lazy coroutine that produces a T. Awaiting it runs it on the awaiting
+// thread, and the awaiter resumes on whatever thread the task finishes
+// (symmetric transfer, so long chains of tasks don't grow the stack).
+// Exceptions are rethrown to the awaiter.
+template <typename T>
+class task
+{
+public:
+    using promise_type = task_promise<T>;
+    using handle_type = std::coroutine_handle<promise_type>;
+
+    explicit task(handle_type h) noexcept
+        : d_handle(h)
+    {}
+
+    task(task&& other) noexcept
+        : d_handle(std::exchange(other.d_handle, nullptr))
+    {}
+
+    task& operator= (task&& other) noexcept
+    {
+        if (this != &other)
+        {
+            if (d_handle)
+                d_handle.destroy();
+            d_handle = std::exchange(other.d_handle, nullptr);
+        }
+        return *this;
+    }
+
+    task(const task&) = delete;
+    task& operator= (const task&) = delete;
+
+    ~task()
+    {
+        if (d_handle)
+            d_handle.destroy();
+    }
+
+    auto operator co_await() && noexcept
+    {
+        struct awaiter
+        {
+            handle_type h;
+
+            bool await_ready() const noexcept
+            {
+                return h.done();
+            }
+
+            std::coroutine_handle<> await_suspend(std::coroutine_handle<> cont) noexcept
+            {
+                h.promise().continuation = cont;
+                return h;
+            }
+
+            T await_resume()
+            {
+                return h.promise().get();
+            }
+        };
+        return awaiter{d_handle};
+    }
+
+private:
+    handle_type d_handle;
+};
+
+template <typename T>
+task<T> task_promise<T>::get_return_object() noexcept
+{
+    return task<T>(std::coroutine_handle<task_promise<T>>::from_promise(*this));
+}
+
+inline task<void> task_promise<void>::get_return_object() noexcept
+{
+    return task<void>(std::coroutine_handle<task_promise<void>>::from_promise(*this));
+}
+
+// Resumes the coroutine on the executor.
+template <typename Executor>
+void resume_on(Executor& ex, std::coroutine_handle<> h)
+{
+    ex.post([h]() { h.resume(); });
+}
+
+// co_await schedule(ex) moves the rest of the coroutine to the executor.
+template <typename Executor>
+auto schedule(Executor& ex) noexcept
+{
+    struct awaiter
+    {
+        Executor& ex;
+
+        bool await_ready() const noexcept
+        {
+            return false;
+        }
+
+        void await_suspend(std::coroutine_handle<> h)
+        {
+            resume_on(ex, h);
+        }
+
+        void await_resume() const noexcept
+        {}
+    };
+    return awaiter{ex};
+}
+
+// Starts right away and frees itself when done, used to run tasks from
+// ordinary functions.
+struct detached_task
+{
+    struct promise_type
+    {
+        detached_task get_return_object() noexcept
+        {
+            return {};
+        }
+
+        std::suspend_never initial_suspend() const noexcept
+        {
+            return {};
+        }
+
+        std::suspend_never final_suspend() const noexcept
+        {
+            return {};
+        }
+
+        void return_void() noexcept
+        {}
+
+        // Nobody is left to rethrow to
+        void unhandled_exception() noexcept
+        {
+            std::terminate();
+        }
+    };
+};
+
+template <typename Executor>
+detached_task spawn_detached(Executor& ex, task<void> t)
+{
+    co_await schedule(ex);
+    co_await std::move(t);
+}
+
+// Runs t on the executor without waiting for it.
+// An exception escaping t terminates the program.
+template <typename Executor>
+void spawn(Executor& ex, task<void> t)
+{
+    spawn_detached(ex, std::move(t));
+}
+
+// The promise lives in the coroutine frame, so it's still alive while
+// set_value returns on the other thread.
+template <typename T>
+detached_task sync_wait_detached(task<T> t, std::promise<T> p)
+{
+    try
+    {
+        if constexpr (std::is_void<T>::value)
+        {
+            co_await std::move(t);
+            p.set_value();
+        }
+        else
+            p.set_value(co_await std::move(t));
+    }
+    catch (...)
+    {
+        p.set_exception(std::current_exception());
+    }
+}
+
+// Runs t on the calling thread until its first suspension, then blocks until
+// it finishes and returns its result (or rethrows its exception).
+template <typename T>
+T sync_wait(task<T> t)
+{
+    std::promise<T> p;
+    std::future<T> f = p.get_future();
+    sync_wait_detached(std::move(t), std::move(p));
+    return f.get();
+}
+
+// A coroutine suspended in a queue's async_pop(). The queue keeps a FIFO
+// list of them, hands an element straight to the oldest one on push, and
+// wakes them all up empty on close.
+template <typename T>
+struct pop_waiter
+{
+    virtual void wake() = 0;
+
+    std::optional<T> value;
+    pop_waiter*      next = nullptr;
+
+protected:
+    ~pop_waiter() = default;
+};
+
+template <typename T>
+class pop_waiter_list
+{
+public:
+    bool empty() const noexcept
+    {
+        return d_head == nullptr;
+    }
+
+    pop_waiter<T>* front() const noexcept
+    {
+        return d_head;
+    }
+
+    void push_back(pop_waiter<T>* w) noexcept
+    {
+        w->next = nullptr;
+        if (d_tail)
+            d_tail->next = w;
+        else
+            d_head = w;
+        d_tail = w;
+    }
+
+    pop_waiter<T>* pop_front() noexcept
+    {
+        pop_waiter<T>* w = d_head;
+        d_head = w->next;
+        if (!d_head)
+            d_tail = nullptr;
+        return w;
+    }
+
+    // Call after unlocking the queue.
+    void wake_all()
+    {
+        while (!empty())
+            pop_front()->wake();
+    }
+
+private:
+    pop_waiter<T>* d_head = nullptr;
+    pop_waiter<T>* d_tail = nullptr;
+};
+
+// Returned by async_pop(ex). Lives in the frame of the awaiting coroutine,
+// so waiting costs no allocation. Resumes with the element, or nullopt if
+// the queue was closed and there are no elements left.
+// Queue::suspend_pop(waiter) either fills waiter.value and returns false,
+// or queues the waiter and returns true.
+template <typename Queue, typename T, typename Executor>
+class pop_awaiter final : public pop_waiter<T>
+{
+public:
+    pop_awaiter(Queue& q, Executor& ex) noexcept
+        : d_queue(q)
+        , d_executor(ex)
+    {}
+
+    bool await_ready() const noexcept
+    {
+        return false;
+    }
+
+    // The coroutine might be resumed on another thread before this returns,
+    // so nothing is touched after suspend_pop.
+    bool await_suspend(std::coroutine_handle<> h)
+    {
+        d_handle = h;
+        return d_queue.suspend_pop(*this);
+    }
+
+    std::optional<T> await_resume()
+    {
+        return std::move(this->value);
+    }
+
+    void wake() override
+    {
+        resume_on(d_executor, d_handle);
+    }
+
+private:
+    Queue&                  d_queue;
+    Executor&               d_executor;
+    std::coroutine_handle<> d_handle;
+};
+
+} // namespace si
+
+#endif
@@ -0,0 +1,337 @@
+#ifndef SI_EPOCH_RECLAMATION_H
+#define SI_EPOCH_RECLAMATION_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+namespace si {
+
+/*
+Epoch-based memory reclamation (EBR), as described in Keir Fraser's thesis
+"Practical lock-freedom", Chapter 5.2.3.
+https://www.cl.cam.ac.uk/techreports/UCAM-CL-TR-579.pdf
+
+- there is a single global epoch counter
+- each thread that touches a lock-free structure registers a record holding
+  the epoch it observed when it entered its critical section and a "pinned" bit
+- objects unlinked from a structure are not deleted right away, they are
+  retired into the calling thread's limbo list, tagged with the current epoch
+- the global epoch can only advance when every pinned thread has observed it
+- an object retired in epoch e can be deleted once the global epoch reaches e + 2,
+  because every thread that could still hold a reference to it has since left
+  the critical section in which it found that reference
+
+Lock-free structures use it through `epoch_guard`:
+
+    epoch_guard guard;              // pin the current thread
+    node* n = d_head.load();        // safe to dereference while pinned
+    ...unlink n...
+    guard.retire(n);                // deleted once no thread can see it
+
+The downside is that a single thread that stalls inside a critical section
+stops the epoch from advancing, so garbage can grow without bound.
+*/
+class epoch_domain
+{
+public:
+    // All the lock-free structures share the same domain so that a thread only
+    // needs to be registered once.
+    static epoch_domain& instance()
+    {
+        static epoch_domain domain;
+        return domain;
+    }
+
+    epoch_domain(const epoch_domain&) = delete;
+    epoch_domain& operator= (const epoch_domain&) = delete;
+
+    ~epoch_domain()
+    {
+        // No thread can be pinned anymore, everything can be reclaimed.
+        for (thread_record* rec = d_records.load(); rec; )
+        {
+            thread_record* next = rec->next;
+            for (auto& r : rec->limbo)
+                r.deleter(r.ptr);
+            delete rec;
+            rec = next;
+        }
+
+        for (auto& r : d_orphans)
+            r.deleter(r.ptr);
+    }
+
+    void pin()
+    {
+        thread_record& rec = local_record();
+        if (rec.nesting++ != 0)
+            return;
+
+        // Publish the epoch we observed before reading any shared pointer.
+        // It's fine if the epoch advances in the meantime, we would only
+        // be holding back reclamation for a bit longer.
+        const uint64_t epoch = d_epoch.load(std::memory_order_relaxed);
+        rec.state.store((epoch << 1) | 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+    }
+
+    void unpin()
+    {
+        thread_record& rec = local_record();
+        if (--rec.nesting != 0)
+            return;
+
+        rec.state.store(0, std::memory_order_release);
+    }
+
+    // Defers deleter(ptr) until no pinned thread can hold a reference to ptr.
+    // Must be called after ptr was unlinked from the shared structure.
+    void retire(void* ptr, void (*deleter)(void*))
+    {
+        thread_record& rec = local_record();
+        rec.limbo.push_back({ptr, deleter, d_epoch.load(std::memory_order_seq_cst)});
+
+        if (rec.limbo.size() >= collect_threshold)
+            collect(rec);
+    }
+
+    template <typename T>
+    void retire(T* ptr)
+    {
+        retire(ptr, [](void* p) { delete static_cast<T*>(p); });
+    }
+
+    // Tries to advance the epoch and reclaims what the calling thread
+    // (and threads that exited) retired in old enough epochs.
+    void collect()
+    {
+        collect(local_record());
+    }
+
+    // Number of objects that were deleted so far.
+    size_t reclaimed() const noexcept
+    {
+        return d_reclaimed.load(std::memory_order_relaxed);
+    }
+
+private:
+    // Try to amortize the cost of scanning all the thread records.
+    static constexpr size_t collect_threshold = 64;
+
+    struct retired
+    {
+        void*    ptr;
+        void     (*deleter)(void*);
+        uint64_t epoch;
+    };
+
+    // Aligned to avoid false sharing between the state of different threads.
+    struct alignas(64) thread_record
+    {
+        // (observed epoch << 1) | pinned bit
+        std::atomic<uint64_t> state{0};
+        // Records are never freed while the domain is alive, they are reused
+        // by new threads after the owning thread exits.
+        std::atomic<bool>     in_use{true};
+        thread_record*        next = nullptr;
+
+        // Only accessed by the owning thread.
+        unsigned              nesting = 0;
+        std::vector<retired>  limbo;
+    };
+
+    // Releases the record when the thread exits.
+    struct thread_handle
+    {
+        thread_record* rec = nullptr;
+
+        ~thread_handle()
+        {
+            if (rec)
+                instance().release_record(*rec);
+        }
+    };
+
+    epoch_domain() = default;
+
+    thread_record& local_record()
+    {
+        thread_local thread_handle handle;
+        if (!handle.rec)
+            handle.rec = acquire_record();
+        return *handle.rec;
+    }
+
+    thread_record* acquire_record()
+    {
+        // Reuse the record of a thread that exited if we can
+        for (thread_record* rec = d_records.load(std::memory_order_acquire); rec; rec = rec->next)
+        {
+            bool in_use = false;
+            if (!rec->in_use.load(std::memory_order_relaxed)
+                && rec->in_use.compare_exchange_strong(in_use, true, std::memory_order_acquire))
+                return rec;
+        }
+
+        thread_record* rec = new thread_record;
+        rec->next = d_records.load(std::memory_order_relaxed);
+        while (!d_records.compare_exchange_weak(rec->next, rec,
+                                                std::memory_order_release,
+                                                std::memory_order_relaxed));
+        return rec;
+    }
+
+    void release_record(thread_record& rec)
+    {
+        collect(rec);
+
+        // Hand over whatever is still not safe to delete
+        if (!rec.limbo.empty())
+        {
+            std::lock_guard<std::mutex> guard(d_orphans_mutex);
+            d_orphans.insert(d_orphans.end(), rec.limbo.begin(), rec.limbo.end());
+            rec.limbo.clear();
+        }
+
+        rec.nesting = 0;
+        rec.state.store(0, std::memory_order_relaxed);
+        rec.in_use.store(false, std::memory_order_release);
+    }
+
+    // Advances the epoch if all pinned threads have observed the current one.
+    uint64_t try_advance()
+    {
+        uint64_t epoch = d_epoch.load(std::memory_order_seq_cst);
+        for (thread_record* rec = d_records.load(std::memory_order_acquire); rec; rec = rec->next)
+        {
+            const uint64_t state = rec->state.load(std::memory_order_seq_cst);
+            if ((state & 1) && (state >> 1) != epoch)
+                return epoch;
+        }
+
+        if (d_epoch.compare_exchange_strong(epoch, epoch + 1, std::memory_order_seq_cst))
+            return epoch + 1;
+        return epoch;
+    }
+
+    // Deletes the retired objects from the beginning of the list that are
+    // at least 2 epochs old. The list is sorted by epoch.
+    size_t reclaim(std::vector<retired>& list, uint64_t epoch)
+    {
+        size_t i = 0;
+        while (i < list.size() && list[i].epoch + 2 <= epoch)
+        {
+            list[i].deleter(list[i].ptr);
+            ++ i;
+        }
+
+        list.erase(list.begin(), list.begin() + i);
+        return i;
+    }
+
+    void collect(thread_record& rec)
+    {
+        const uint64_t epoch = try_advance();
+        size_t count = reclaim(rec.limbo, epoch);
+
+        // Don't wait for other threads that are collecting orphans.
+        std::unique_lock<std::mutex> ulock(d_orphans_mutex, std::try_to_lock);
+        if (ulock.owns_lock() && !d_orphans.empty())
+            count += reclaim(d_orphans, epoch);
+
+        if (count)
+            d_reclaimed.fetch_add(count, std::memory_order_relaxed);
+    }
+
+    std::atomic<uint64_t>       d_epoch{0};
+    std::atomic<thread_record*> d_records{nullptr};
+    std::atomic<size_t>         d_reclaimed{0};
+
+    // Retired objects left behind by threads that exited.
+    std::vector<retired>        d_orphans;
+    std::mutex                  d_orphans_mutex;
+};
+
+// Keeps the current thread pinned in the global epoch domain for its lifetime.
+// Pointers loaded from a lock-free structure are safe to dereference while
+// the guard is alive. Guards can be nested.
+class epoch_guard
+{
+public:
+    epoch_guard()
+        : d_domain(epoch_domain::instance())
+    {
+        d_domain.pin();
+    }
+
+    ~epoch_guard()
+    {
+        d_domain.unpin();
+    }
+
+    epoch_guard(const epoch_guard&) = delete;
+    epoch_guard& operator= (const epoch_guard&) = delete;
+
+    template <typename T>
+    void retire(T* ptr)
+    {
+        d_domain.retire(ptr);
+    }
+
+private:
+    epoch_domain& d_domain;
+};
+
+// Reclamation policy for the lock-free containers.
+// Each container owns a reclaimer<Node> that creates and destroys its nodes.
+// Operations that dereference shared nodes create a guard, load the nodes
+// through protect() and retire the nodes they unlink.
+struct epoch_reclamation
+{
+    template <typename Node>
+    class reclaimer
+    {
+    public:
+        template <typename ... Args>
+        Node* create(Args&&... args)
+        {
+            return new Node(std::forward<Args>(args)...);
+        }
+
+        // Only for nodes that no other thread can see.
+        void destroy(Node* node)
+        {
+            delete node;
+        }
+
+        class guard
+        {
+        public:
+            explicit guard(reclaimer&)
+            {}
+
+            // Everything loaded while pinned is protected.
+            template <typename P>
+            P protect(const std::atomic<P>& src)
+            {
+                return src.load();
+            }
+
+            void retire(Node* node)
+            {
+                d_guard.retire(node);
+            }
+
+        private:
+            epoch_guard d_guard;
+        };
+    };
+};
+
+} // namespace si
+
+#endif
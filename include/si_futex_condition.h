@@ -0,0 +1,156 @@
+#ifndef SI_FUTEX_CONDITION_H
+#define SI_FUTEX_CONDITION_H
+
+#include <atomic>
+#include <chrono>
+#include <climits>
+#include <condition_variable>
+#include <cstdint>
+#include <ctime>
+#include <mutex>
+#include <type_traits>
+
+#ifdef __linux__
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace si {
+
+#ifdef __linux__
+// Condition variable for any BasicLockable, like std::condition_variable_any,
+// but without the internal mutex and shared_ptr of the libstdc++ one: a wait
+// is a futex wait on a sequence number, and a notify is an increment plus a
+// wake up syscall only when a waiter wasn't already woken up.
+//
+// As with the standard ones the notifier must change the state under the
+// lock, then the waiter either sees the new state or sleeps on a sequence
+// number that was read before the notify bumped it.
+class futex_condition
+{
+public:
+    futex_condition() = default;
+    futex_condition(const futex_condition&) = delete;
+    futex_condition& operator= (const futex_condition&) = delete;
+
+    template <typename Lock>
+    void wait(Lock& lock)
+    {
+        wait_until_woken(lock, nullptr);
+    }
+
+    template <typename Lock, typename Predicate>
+    void wait(Lock& lock, Predicate pred)
+    {
+        while (!pred())
+            wait(lock);
+    }
+
+    // Returns pred() once it's true or the timeout expired.
+    template <typename Lock, typename Rep, typename Period, typename Predicate>
+    bool wait_for(Lock& lock, const std::chrono::duration<Rep, Period>& timeout, Predicate pred)
+    {
+        using namespace std::chrono;
+        const auto deadline = steady_clock::now() + timeout;
+        while (!pred())
+        {
+            const nanoseconds remaining = duration_cast<nanoseconds>(deadline - steady_clock::now());
+            if (remaining <= nanoseconds::zero())
+                return pred();
+
+            // futex timeouts are relative, on the monotonic clock
+            const timespec ts{static_cast<time_t>(remaining.count() / 1000000000),
+                              static_cast<long>(remaining.count() % 1000000000)};
+            wait_until_woken(lock, &ts);
+        }
+        return true;
+    }
+
+    void notify_one() noexcept
+    {
+        d_seq.fetch_add(1);
+        // Nothing to do if every waiter already has a wake up on its way
+        uint64_t counts = d_counts.load();
+        while (pending(counts) < waiters(counts))
+            if (d_counts.compare_exchange_weak(counts, counts + 1))
+            {
+                futex(FUTEX_WAKE_PRIVATE, 1, nullptr);
+                return;
+            }
+    }
+
+    void notify_all() noexcept
+    {
+        d_seq.fetch_add(1);
+        uint64_t counts = d_counts.load();
+        while (pending(counts) < waiters(counts))
+            if (d_counts.compare_exchange_weak(counts, counts - pending(counts) + waiters(counts)))
+            {
+                futex(FUTEX_WAKE_PRIVATE, INT_MAX, nullptr);
+                return;
+            }
+    }
+
+private:
+    // The lock orders the read of d_seq and the waiters increment before
+    // any notify that follows a change of the state.
+    template <typename Lock>
+    void wait_until_woken(Lock& lock, const timespec* timeout)
+    {
+        const uint32_t seq = d_seq.load();
+        d_counts.fetch_add(one_waiter);
+        lock.unlock();
+
+        // Returns right away if d_seq changed since, spurious wake ups are
+        // handled by the callers' predicates
+        futex(FUTEX_WAIT_PRIVATE, seq, timeout);
+
+        // Leaves and takes a pending wake up in one step, even if the wake up
+        // was meant for another waiter: the worst case is a useless syscall
+        // in a later notify. Done separately, a notify in between could count
+        // a wake up for a waiter that already left, and then skip the syscall
+        // for the ones still asleep.
+        uint64_t counts = d_counts.load();
+        while (!d_counts.compare_exchange_weak(counts, counts - one_waiter - (pending(counts) ? 1 : 0)))
+            ;
+        lock.lock();
+    }
+
+    long futex(int op, uint32_t val, const timespec* timeout) noexcept
+    {
+        return syscall(SYS_futex, reinterpret_cast<uint32_t*>(&d_seq), op, val, timeout, nullptr, 0);
+    }
+
+    static_assert(sizeof(std::atomic<uint32_t>) == sizeof(uint32_t)
+                  && std::atomic<uint32_t>::is_always_lock_free, "futex needs a plain 32-bit word");
+
+    // The waiters in the high half, and in the low half the wake ups sent to
+    // waiters that didn't leave yet, never more than the waiters.
+    static constexpr uint64_t one_waiter = uint64_t(1) << 32;
+
+    static uint64_t waiters(uint64_t counts) noexcept
+    {
+        return counts >> 32;
+    }
+
+    static uint64_t pending(uint64_t counts) noexcept
+    {
+        return counts & (one_waiter - 1);
+    }
+
+    std::atomic<uint32_t> d_seq{0};
+    std::atomic<uint64_t> d_counts{0};
+};
+#endif
+
+// What the locked containers wait with by default: std::condition_variable
+// for std::mutex, std::condition_variable_any for anything else.
+template <typename Lock>
+using default_condition = typename std::conditional<std::is_same<Lock, std::mutex>::value,
+                                                    std::condition_variable,
+                                                    std::condition_variable_any>::type;
+
+} // namespace si
+
+#endif
@@ -0,0 +1,360 @@
+#ifndef SI_HAZARD_POINTERS_H
+#define SI_HAZARD_POINTERS_H
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <mutex>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace si {
+
+/*
+Hazard pointer memory reclamation, as described by Maged Michael in
+"Hazard Pointers: Safe Memory Reclamation for Lock-Free Objects".
+https://www.cs.otago.ac.nz/cosc440/readings/hazard-pointers.pdf
+Also see Concurrency In Action, Second Edition, Chapter 7.2.3.
+
+- each registered thread owns a few hazard slots
+- before dereferencing a pointer loaded from a shared structure, a thread
+  publishes it in one of its slots and then checks that the pointer is still
+  reachable from the structure
+- objects unlinked from a structure are retired into the calling thread's list
+- when the list reaches a threshold proportional to the total number of slots,
+  the thread scans all the slots and deletes every retired object that is not
+  hazardous
+
+Compared to epoch-based reclamation, protecting a pointer costs a store and a
+full fence, but a stalled thread can only hold back the few objects its slots
+point to, so the amount of garbage is bounded.
+*/
+class hazard_pointer_domain
+{
+public:
+    static constexpr size_t slots_per_thread = 4;
+
+    // All the lock-free structures share the same domain so that a thread only
+    // needs to be registered once.
+    static hazard_pointer_domain& instance()
+    {
+        static hazard_pointer_domain domain;
+        return domain;
+    }
+
+    hazard_pointer_domain(const hazard_pointer_domain&) = delete;
+    hazard_pointer_domain& operator= (const hazard_pointer_domain&) = delete;
+
+    ~hazard_pointer_domain()
+    {
+        // No thread can hold a hazard pointer anymore, everything can be reclaimed.
+        for (thread_record* rec = d_records.load(); rec; )
+        {
+            thread_record* next = rec->next;
+            for (auto& r : rec->retired_list)
+                r.deleter(r.ptr);
+            delete rec;
+            rec = next;
+        }
+
+        for (auto& r : d_orphans)
+            r.deleter(r.ptr);
+    }
+
+    // Returns a free hazard slot of the calling thread.
+    std::atomic<void*>& acquire_slot()
+    {
+        thread_record& rec = local_record();
+        for (size_t i = 0; i < slots_per_thread; ++ i)
+        {
+            if (!(rec.used_slots & (1u << i)))
+            {
+                rec.used_slots |= 1u << i;
+                return rec.slots[i];
+            }
+        }
+
+        throw std::runtime_error("No hazard pointer slots left.");
+    }
+
+    void release_slot(std::atomic<void*>& slot)
+    {
+        thread_record& rec = local_record();
+        slot.store(nullptr, std::memory_order_release);
+        rec.used_slots &= ~(1u << (&slot - rec.slots));
+    }
+
+    // Defers deleter(ptr) until no hazard slot points to ptr.
+    // Must be called after ptr was unlinked from the shared structure.
+    void retire(void* ptr, void (*deleter)(void*))
+    {
+        thread_record& rec = local_record();
+        rec.retired_list.push_back({ptr, deleter});
+
+        if (rec.retired_list.size() >= scan_threshold())
+            scan(rec);
+    }
+
+    template <typename T>
+    void retire(T* ptr)
+    {
+        retire(ptr, [](void* p) { delete static_cast<T*>(p); });
+    }
+
+    // Reclaims what the calling thread (and threads that exited) retired
+    // and is not protected anymore.
+    void collect()
+    {
+        scan(local_record());
+    }
+
+    // Number of objects that were deleted so far.
+    size_t reclaimed() const noexcept
+    {
+        return d_reclaimed.load(std::memory_order_relaxed);
+    }
+
+private:
+    struct retired
+    {
+        void* ptr;
+        void  (*deleter)(void*);
+    };
+
+    // Aligned to avoid false sharing between the slots of different threads.
+    struct alignas(64) thread_record
+    {
+        std::atomic<void*>   slots[slots_per_thread] = {};
+        // Records are never freed while the domain is alive, they are reused
+        // by new threads after the owning thread exits.
+        std::atomic<bool>    in_use{true};
+        thread_record*       next = nullptr;
+
+        // Only accessed by the owning thread.
+        unsigned             used_slots = 0;
+        std::vector<retired> retired_list;
+    };
+
+    // Releases the record when the thread exits.
+    struct thread_handle
+    {
+        thread_record* rec = nullptr;
+
+        ~thread_handle()
+        {
+            if (rec)
+                instance().release_record(*rec);
+        }
+    };
+
+    hazard_pointer_domain() = default;
+
+    thread_record& local_record()
+    {
+        thread_local thread_handle handle;
+        if (!handle.rec)
+            handle.rec = acquire_record();
+        return *handle.rec;
+    }
+
+    thread_record* acquire_record()
+    {
+        // Reuse the record of a thread that exited if we can
+        for (thread_record* rec = d_records.load(std::memory_order_acquire); rec; rec = rec->next)
+        {
+            bool in_use = false;
+            if (!rec->in_use.load(std::memory_order_relaxed)
+                && rec->in_use.compare_exchange_strong(in_use, true, std::memory_order_acquire))
+                return rec;
+        }
+
+        thread_record* rec = new thread_record;
+        rec->next = d_records.load(std::memory_order_relaxed);
+        while (!d_records.compare_exchange_weak(rec->next, rec,
+                                                std::memory_order_release,
+                                                std::memory_order_relaxed));
+        d_num_records.fetch_add(1, std::memory_order_relaxed);
+        return rec;
+    }
+
+    void release_record(thread_record& rec)
+    {
+        for (auto& slot : rec.slots)
+            slot.store(nullptr, std::memory_order_release);
+        rec.used_slots = 0;
+
+        scan(rec);
+
+        // Hand over whatever is still protected by other threads
+        if (!rec.retired_list.empty())
+        {
+            std::lock_guard<std::mutex> guard(d_orphans_mutex);
+            d_orphans.insert(d_orphans.end(), rec.retired_list.begin(), rec.retired_list.end());
+            rec.retired_list.clear();
+        }
+
+        rec.in_use.store(false, std::memory_order_release);
+    }
+
+    // Scanning all the slots costs O(H), so only do it once we have
+    // O(H) retired objects. At least half of them will be reclaimed.
+    size_t scan_threshold() const noexcept
+    {
+        return 2 * slots_per_thread * d_num_records.load(std::memory_order_relaxed) + 64;
+    }
+
+    // Deletes the retired objects that are not in the sorted list of hazards.
+    size_t reclaim(std::vector<retired>& list, const std::vector<void*>& hazards)
+    {
+        const auto it = std::partition(list.begin(), list.end(), [&hazards](const retired& r) {
+            return std::binary_search(hazards.begin(), hazards.end(), r.ptr);
+        });
+
+        const size_t count = list.end() - it;
+        for (auto del = it; del != list.end(); ++ del)
+            del->deleter(del->ptr);
+        list.erase(it, list.end());
+        return count;
+    }
+
+    void scan(thread_record& rec)
+    {
+        // Pairs with the fence in hazard_pointer::protect(): either the other thread
+        // sees the object as unlinked, or we see its hazard pointer.
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+
+        std::vector<void*> hazards;
+        for (thread_record* r = d_records.load(std::memory_order_acquire); r; r = r->next)
+            for (auto& slot : r->slots)
+                if (void* p = slot.load(std::memory_order_acquire))
+                    hazards.push_back(p);
+        std::sort(hazards.begin(), hazards.end());
+
+        size_t count = reclaim(rec.retired_list, hazards);
+
+        // Don't wait for other threads that are collecting orphans.
+        std::unique_lock<std::mutex> ulock(d_orphans_mutex, std::try_to_lock);
+        if (ulock.owns_lock() && !d_orphans.empty())
+            count += reclaim(d_orphans, hazards);
+
+        if (count)
+            d_reclaimed.fetch_add(count, std::memory_order_relaxed);
+    }
+
+    std::atomic<thread_record*> d_records{nullptr};
+    std::atomic<size_t>         d_num_records{0};
+    std::atomic<size_t>         d_reclaimed{0};
+
+    // Retired objects left behind by threads that exited.
+    std::vector<retired>        d_orphans;
+    std::mutex                  d_orphans_mutex;
+};
+
+template <typename T>
+T* raw_pointer(T* ptr) noexcept
+{
+    return ptr;
+}
+
+// Owns one hazard slot of the calling thread for its lifetime.
+class hazard_pointer
+{
+public:
+    hazard_pointer()
+        : d_domain(hazard_pointer_domain::instance())
+        , d_slot(d_domain.acquire_slot())
+    {}
+
+    ~hazard_pointer()
+    {
+        d_domain.release_slot(d_slot);
+    }
+
+    hazard_pointer(const hazard_pointer&) = delete;
+    hazard_pointer& operator= (const hazard_pointer&) = delete;
+
+    // Loads src and keeps the returned object from being deleted until
+    // the next protect() or reset(), even if it gets retired.
+    // P is either a raw pointer or a pointer-like type with a raw_pointer() overload.
+    template <typename P>
+    P protect(const std::atomic<P>& src)
+    {
+        P ptr = src.load(std::memory_order_relaxed);
+        for (;;)
+        {
+            d_slot.store(raw_pointer(ptr), std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+
+            // If src still points to ptr, ptr was not retired before
+            // our hazard pointer became visible.
+            P again = src.load(std::memory_order_acquire);
+            if (again == ptr)
+                return ptr;
+            ptr = again;
+        }
+    }
+
+    void reset()
+    {
+        d_slot.store(nullptr, std::memory_order_release);
+    }
+
+    template <typename T>
+    void retire(T* ptr)
+    {
+        d_domain.retire(ptr);
+    }
+
+private:
+    hazard_pointer_domain& d_domain;
+    std::atomic<void*>&    d_slot;
+};
+
+// Reclamation policy for the lock-free containers, see epoch_reclamation.
+struct hazard_pointer_reclamation
+{
+    template <typename Node>
+    class reclaimer
+    {
+    public:
+        template <typename ... Args>
+        Node* create(Args&&... args)
+        {
+            return new Node(std::forward<Args>(args)...);
+        }
+
+        // Only for nodes that no other thread can see.
+        void destroy(Node* node)
+        {
+            delete node;
+        }
+
+        class guard
+        {
+        public:
+            explicit guard(reclaimer&)
+            {}
+
+            template <typename P>
+            P protect(const std::atomic<P>& src)
+            {
+                return d_hp.protect(src);
+            }
+
+            // We don't need to protect the node anymore, it was unlinked by us.
+            void retire(Node* node)
+            {
+                d_hp.reset();
+                d_hp.retire(node);
+            }
+
+        private:
+            hazard_pointer d_hp;
+        };
+    };
+};
+
+} // namespace si
+
+#endif
@@ -1,44 +1,317 @@
 #ifndef SI_LOCKFREE_STACK_H
 #define SI_LOCKFREE_STACK_H
 
+#include <si_epoch_reclamation.h>
+#include <si_hazard_pointers.h>
+#include <si_node_freelist.h>
+#include <si_tagged_ptr.h>
+
+#include <array>
 #include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <immintrin.h> // for _mm_pause
 #include <memory>
+#include <optional>
+#include <thread>
+#include <type_traits>
+#include <utility>
 
 namespace si {
 
-// Lock-free stack that leaks nodes. For a version that frees memory, see
+// Never frees popped nodes, kept as a baseline for the other policies.
+struct leak_reclamation
+{
+    template <typename Node>
+    class reclaimer
+    {
+    public:
+        template <typename ... Args>
+        Node* create(Args&&... args)
+        {
+            return new Node(std::forward<Args>(args)...);
+        }
+
+        void destroy(Node* node)
+        {
+            delete node;
+        }
+
+        struct guard
+        {
+            explicit guard(reclaimer&)
+            {}
+
+            template <typename P>
+            P protect(const std::atomic<P>& src)
+            {
+                return src.load();
+            }
+
+            void retire(Node*)
+            {}
+        };
+    };
+};
+
+// Elimination array from "A Scalable Lock-free Stack Algorithm" by Hendler, Shavit and Yerushalmi.
+// https://people.csail.mit.edu/shanir/publications/Lock_Free.pdf
+// A push and a pop that both failed their CAS on the head of the stack meet
+// in a random slot and exchange the node directly, so they cancel each other
+// out without touching the head. The more threads contend, the more likely
+// they are to meet.
+template <typename Node, size_t Slots>
+class elimination_array
+{
+public:
+    // Offers the node in a random slot for a short while.
+    // Returns true if a pop took it.
+    bool try_push(Node* node) noexcept
+    {
+        std::atomic<Node*>& slot = random_slot();
+        Node* expected = nullptr;
+        if (!slot.compare_exchange_strong(expected, node, std::memory_order_release, std::memory_order_relaxed))
+            return false;
+
+        for (unsigned i = 0; i < spin_count; ++ i)
+        {
+            if (slot.load(std::memory_order_relaxed) != node)
+                return true;
+            _mm_pause();
+        }
+
+        // Take the node back, unless a pop took it in the meantime
+        expected = node;
+        return !slot.compare_exchange_strong(expected, nullptr, std::memory_order_relaxed);
+    }
+
+    // Waits a short while for a push in a random slot.
+    // Returns the node that was taken or nullptr.
+    Node* try_pop() noexcept
+    {
+        std::atomic<Node*>& slot = random_slot();
+        for (unsigned i = 0; i < spin_count; ++ i)
+        {
+            Node* node = slot.load(std::memory_order_relaxed);
+            if (node && slot.compare_exchange_strong(node, nullptr, std::memory_order_acquire, std::memory_order_relaxed))
+                return node;
+            _mm_pause();
+        }
+
+        return nullptr;
+    }
+
+private:
+    static constexpr unsigned spin_count = 64;
+
+    // Each slot is on its own cache line
+    struct alignas(64) slot_type
+    {
+        std::atomic<Node*> node{nullptr};
+    };
+
+    std::atomic<Node*>& random_slot() noexcept
+    {
+        // xorshift32, seeded differently on each thread
+        thread_local uint32_t state = static_cast<uint32_t>(std::hash<std::thread::id>()(std::this_thread::get_id())) | 1;
+        state ^= state << 13;
+        state ^= state >> 17;
+        state ^= state << 5;
+        return d_slots[state % Slots].node;
+    }
+
+    std::array<slot_type, Slots> d_slots;
+};
+
+// Lock-free stack. Popped nodes are freed according to the Reclaimer policy:
+// - epoch_reclamation: cheap, but a stalled thread can hold back all the garbage
+// - hazard_pointer_reclamation: bounded garbage, but a fence on every pop
+// - freelist_reclamation: nodes are recycled, no allocations in steady state
+// - leak_reclamation: never frees popped nodes
+//
+// The head is a tagged_ptr, so a pop can't succeed if the head was popped and
+// pushed back in the meantime (ABA), even when node addresses are reused.
+//
+// With EliminationSlots > 0, pushes and pops that fail their CAS on the head
+// try to cancel each other out in an elimination_array first. This lets
+// throughput scale under heavy symmetric push/pop load, at the cost of some
+// latency when there is no partner.
+//
+// For a version that uses reference counting instead, see
 // Concurrency In Action, Second Edition by Anthony Williams, Chapter 7.2.2.
 // https://github.com/anthonywilliams/ccia_code_samples/blob/main/listings/listing_7.13.cpp
-template <class T>
+template <class T, class Reclaimer = epoch_reclamation, size_t EliminationSlots = 0>
 class lockfree_stack
 {
 public:
+    lockfree_stack() = default;
+
+    lockfree_stack(const lockfree_stack&) = delete;
+    lockfree_stack& operator= (const lockfree_stack&) = delete;
+
+    // Assumes no other thread is using the stack anymore.
+    ~lockfree_stack()
+    {
+        node* cur = d_head.load().get();
+        while (cur)
+        {
+            node* next = load_next(cur);
+            d_reclaimer.destroy(cur);
+            cur = next;
+        }
+    }
+
     void push(const T& val)
     {
-        node* new_node = new node(val, d_head.load());
-        while (!d_head.compare_exchange_weak(new_node->next, new_node));
+        push_node(d_reclaimer.create(val));
+    }
+
+    void push(T&& val)
+    {
+        push_node(d_reclaimer.create(std::move(val)));
+    }
+
+    // Constructs the value in place. With freelist_reclamation the node
+    // memory is recycled, so nothing is allocated in steady state.
+    template <typename ... Args>
+    void emplace(Args&&... args)
+    {
+        push_node(d_reclaimer.create(std::forward<Args>(args)...));
     }
 
     std::shared_ptr<T> pop()
     {
-        node* old_head = d_head.load();
-        while (old_head && !d_head.compare_exchange_weak(old_head, old_head->next));
-        return old_head ? old_head->data : std::make_shared<T>();
+        typename reclaimer_type::guard guard(d_reclaimer);
+        node* old_head = pop_node(guard);
+        if (!old_head)
+            return std::make_shared<T>();
+
+        auto res = std::make_shared<T>(std::move(old_head->data));
+        guard.retire(old_head);
+        return res;
+    }
+
+    // Doesn't allocate with freelist_reclamation or leak_reclamation, unless
+    // moving T does. The retire of the other policies may grow a vector.
+    bool try_pop(T& result)
+    {
+        typename reclaimer_type::guard guard(d_reclaimer);
+        node* old_head = pop_node(guard);
+        if (!old_head)
+            return false;
+
+        result = std::move(old_head->data);
+        guard.retire(old_head);
+        return true;
+    }
+
+    std::optional<T> try_pop()
+    {
+        typename reclaimer_type::guard guard(d_reclaimer);
+        node* old_head = pop_node(guard);
+        if (!old_head)
+            return std::nullopt;
+
+        std::optional<T> res(std::move(old_head->data));
+        guard.retire(old_head);
+        return res;
     }
 
 private:
-    struct node
+    // With freelist_reclamation a popped node can be destroyed and created
+    // again while a losing pop still reads its link, so the link is the word
+    // the pool keeps next to the node instead of a member of the node.
+    static constexpr bool links_in_pool = requires { Reclaimer::links_in_pool; };
+
+    struct pooled_node
+    {
+        T data;
+
+        template <typename ... Args>
+        pooled_node(Args&&... args)
+            : data(std::forward<Args>(args)...)
+        {}
+    };
+
+    struct linked_node
     {
-        std::shared_ptr<T> data;
-        node* next;
+        T data;
+        // Atomic because other threads might read it after the node was popped.
+        std::atomic<linked_node*> next{nullptr};
 
-        node(const T& val, node* ptr)
-            : data(std::make_shared<T>(val))
-            , next(ptr)
+        template <typename ... Args>
+        linked_node(Args&&... args)
+            : data(std::forward<Args>(args)...)
         {}
     };
 
-    std::atomic<node*> d_head;
+    using node = typename std::conditional<links_in_pool, pooled_node, linked_node>::type;
+    using reclaimer_type = typename Reclaimer::template reclaimer<node>;
+
+    static node* load_next(node* n) noexcept
+    {
+        if constexpr (links_in_pool)
+            return static_cast<node*>(reclaimer_type::link(n).load(std::memory_order_relaxed));
+        else
+            return n->next.load(std::memory_order_relaxed);
+    }
+
+    static void store_next(node* n, node* next) noexcept
+    {
+        if constexpr (links_in_pool)
+            reclaimer_type::link(n).store(next, std::memory_order_relaxed);
+        else
+            n->next.store(next, std::memory_order_relaxed);
+    }
+
+    void push_node(node* new_node)
+    {
+        tagged_ptr<node> old_head = d_head.load(std::memory_order_relaxed);
+        for (;;)
+        {
+            store_next(new_node, old_head.get());
+            if (d_head.compare_exchange_weak(old_head, tagged_ptr<node>(new_node, old_head.tag() + 1)))
+                return;
+
+            if constexpr (EliminationSlots > 0)
+            {
+                if (d_elimination.try_push(new_node))
+                    return;
+                old_head = d_head.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    // Returns the node that was unlinked, or nullptr if the stack was empty.
+    // The guard keeps the nodes we load from d_head from being freed, so
+    // dereferencing old_head is safe. With freelist_reclamation they can be
+    // recycled, but the link we read outlives them. Only the thread that
+    // unlinked a node touches its data.
+    node* pop_node(typename reclaimer_type::guard& guard)
+    {
+        for (;;)
+        {
+            tagged_ptr<node> old_head = guard.protect(d_head);
+            if (!old_head)
+                return nullptr;
+
+            if (d_head.compare_exchange_weak(old_head,
+                    tagged_ptr<node>(load_next(old_head.get()), old_head.tag() + 1)))
+                return old_head.get();
+
+            // A node taken from a push was never in the stack, so retiring it is safe.
+            if constexpr (EliminationSlots > 0)
+            {
+                if (node* eliminated = d_elimination.try_pop())
+                    return eliminated;
+            }
+        }
+    }
+
+    std::atomic<tagged_ptr<node>>               d_head{tagged_ptr<node>()};
+    reclaimer_type                              d_reclaimer;
+    elimination_array<node, EliminationSlots>   d_elimination;
 };
 
 } // namespace si
@@ -2,11 +2,12 @@
 
 #include <unistd.h>
 #include <assert.h>
+#include <stdint.h>
 
 namespace si {
 
 /*
-First-fit with coalescing malloc implementation.
+Malloc with size-class bins and coalescing.
 
 - the heap space will be split into free and allocated chunks with the following structure:
 
@@ -18,7 +19,9 @@ First-fit with coalescing malloc implementation.
           free chunk -> +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
                         | size of chunk, in bytes                                   |C|P|
                         +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
-                        | pointer to next free chunk                                    |
+                        | pointer to next free chunk in the bin                         |
+                        +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+                        | pointer to previous free chunk in the bin                     |
                         +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
                         | unallocated space                                             |
                         |                                                               |
@@ -34,35 +37,44 @@ First-fit with coalescing malloc implementation.
             - P (size & 0x01) = previous chunk is free
             - size & 0x04 can potentially be used later for optimizations such as using
               mmap for large allocations.
-    - the minimum chunk size is 16 bytes on 32-bit systems and 24 bytes on 64-bit systems
-    - only free chunks have a pointer to next free chunk
-        - this points to the first size (not the unallocated space)
+    - the minimum chunk size is 16 bytes on 32-bit systems and 32 bytes on 64-bit systems
+    - only free chunks have the pointers to the next and previous free chunks
+        - these point to the first size (not the unallocated space)
+        - a free chunk is never next to another free chunk, they are coalesced
+    - each region returned by sbrk ends with a fencepost: an allocated chunk of size 0,
+      so we never look past the end of a region
+        - if the next region starts right after it, the fencepost becomes part of the
+          first chunk of that region
+
+- bins
+    - free chunks are kept in NUM_BINS doubly linked lists, by size
+        - small bins: one per size below SMALL_BIN_LIMIT, every chunk in a bin fits
+        - large bins: four per power of two, the last one holds everything bigger
+    - a bitmap has a bit set for each non-empty bin
 
 - malloc algorithm
-    - start with pointer to first free chunk
-    - go through each free chunk using next pointers
-        - find the first available space (first fit)
-    - if not enough space, use sbrk
-    - split the found chunk into allocated and free
+    - if the bin of the required size is a small bin and isn't empty, take its first chunk
+    - if it's a large bin, take the first chunk in it that is big enough
+    - otherwise take the first chunk of the next non-empty bin, found with the bitmap
+    - if there is none, use sbrk, free the new space and look again
+    - split the found chunk into allocated and free, the free one goes to its bin
 
 - free algorithm
     - assume this is an allocated chunk (otherwise undefined behaviour)
     - check if we can merge with the previous chunk
-        - use the P bit in the size
+        - use the P bit in the size and the size at the end of the previous chunk
     - check if we can merge next chunk
-        - use pointer to next free chunk, see if it's the same as the next chunk
-    - merge if needed
-        - update size at the beginning and end
-        - update previous free chunk's next pointer
+        - use the C bit in the size of the next chunk
+    - take the merged chunks out of their bins
+        - update the size at the beginning and end
+        - put the result in its bin
 
 - potential optimizations
     - use mmap, munmap if the allocation is bigger than 1mb
         - be careful to not coalesce mmap-ed chunks with brk-ed chunks (they might not be contiguous)
     - http://gee.cs.oswego.edu/dl/html/malloc.html
         - release the last chunk with sbrk(negative_value) if above a certain threshold
-        - hold free chunks in bins sorted by size
-            - each bin is a linked list of free chunks
-            - elements in each bin can also be sorted (for best-fit instead of first-fit)
+        - sort the chunks in the large bins (for best-fit instead of first-fit)
         - locality preservation (try to put chunks that were allocated around the same time close to each other)
         - deferred coalescing
             - new allocations of the same size can just reuse the current free chunk and avoid a later split
@@ -74,13 +86,20 @@ First-fit with coalescing malloc implementation.
 
 #define CHUNK_SIZE_T    size_t
 #define CHUNK_ADDR_T    void *
-#define MIN_ALLOC_SIZE  (sizeof(CHUNK_SIZE_T) + sizeof(CHUNK_ADDR_T *))
+#define MIN_ALLOC_SIZE  (sizeof(CHUNK_SIZE_T) + 2 * sizeof(CHUNK_ADDR_T *))
 #define SBRK_ALLOC_SIZE (4096 * 16)
 #define MIN_ALIGNMENT   8
 #define CONTROL_MASK    0x07
+#define NUM_BINS        128
+#define SMALL_BIN_LIMIT 512
+#define BINS_PER_POWER  4
 
-// Pointer to the address of the first free chunk
-static CHUNK_ADDR_T first_free_chunk = NULL;
+// The first free chunk of each bin
+static CHUNK_ADDR_T bins[NUM_BINS];
+// Bit i is set if bins[i] is not empty
+static uint64_t bin_map[NUM_BINS / 64];
+// Address of the fencepost at the end of the last region returned by sbrk
+static CHUNK_ADDR_T heap_end = NULL;
 
 // Ensures alignment
 inline size_t next_aligned(size_t size)
@@ -88,12 +107,18 @@ inline size_t next_aligned(size_t size)
     return size + ((MIN_ALIGNMENT - (size & CONTROL_MASK)) & CONTROL_MASK);
 }
 
-// Returns a pointer to the address of the next available free chunk
+// Returns a pointer to the address of the next free chunk in the bin
 inline CHUNK_ADDR_T* next_free(CHUNK_ADDR_T free_chunk)
 {
     return (CHUNK_ADDR_T*)(static_cast<char*>(free_chunk) + sizeof(CHUNK_SIZE_T));
 }
 
+// Returns a pointer to the address of the previous free chunk in the bin
+inline CHUNK_ADDR_T* prev_free(CHUNK_ADDR_T free_chunk)
+{
+    return (CHUNK_ADDR_T*)(static_cast<char*>(free_chunk) + sizeof(CHUNK_SIZE_T) + sizeof(CHUNK_ADDR_T));
+}
+
 inline CHUNK_SIZE_T get_size_from_beginning(CHUNK_ADDR_T free_chunk)
 {
     return *(static_cast<CHUNK_SIZE_T *>(free_chunk));
@@ -116,142 +141,201 @@ inline void set_size_at_beginning(CHUNK_ADDR_T chunk, size_t size)
 inline void set_size_free_chunk(CHUNK_ADDR_T free_chunk, size_t size)
 {
     set_size_at_beginning(free_chunk, size);
-    *(size_t*)(static_cast<char*>(free_chunk) + size - sizeof(CHUNK_SIZE_T)) = size;
+    *(size_t*)(static_cast<char*>(free_chunk) + (size & ~CONTROL_MASK) - sizeof(CHUNK_SIZE_T)) = size;
 }
 
-inline void mark_last_free(CHUNK_ADDR_T free_chunk)
+// Bins below SMALL_BIN_LIMIT / MIN_ALIGNMENT hold a single size, the ones
+// above split each power of two into BINS_PER_POWER ranges.
+inline size_t bin_index(CHUNK_SIZE_T chunk_size)
 {
-    *next_free(free_chunk) = NULL;
+    if (chunk_size < SMALL_BIN_LIMIT)
+        return chunk_size / MIN_ALIGNMENT;
+
+    const size_t power = 63 - __builtin_clzll(chunk_size);
+    const size_t small_power = __builtin_ctzll(SMALL_BIN_LIMIT);
+    const size_t range = (chunk_size >> (power - 2)) & (BINS_PER_POWER - 1);
+    const size_t index = SMALL_BIN_LIMIT / MIN_ALIGNMENT + (power - small_power) * BINS_PER_POWER + range;
+    return index < NUM_BINS ? index : NUM_BINS - 1;
 }
 
+// Adds the free chunk at the front of its bin
+inline void insert_free(CHUNK_ADDR_T free_chunk)
+{
+    const size_t index = bin_index(get_size_from_beginning(free_chunk) & ~CONTROL_MASK);
+    CHUNK_ADDR_T const head = bins[index];
+
+    *next_free(free_chunk) = head;
+    *prev_free(free_chunk) = NULL;
+    if (head)
+        *prev_free(head) = free_chunk;
 
-// Checks if the previous free chunk ends at the position where the current chunk starts.
-// If so, it means the previous chunk is free and updates the P bit in size of the current chunk.
-void update_chunk_P_bit(CHUNK_ADDR_T chunk, CHUNK_SIZE_T p_bit_mask)
+    bins[index] = free_chunk;
+    bin_map[index / 64] |= uint64_t(1) << (index % 64);
+}
+
+// Removes the free chunk from its bin, its size must still be set
+inline void unlink_free(CHUNK_ADDR_T free_chunk)
 {
-    // First confirm that we are not at the end of the heap
-    CHUNK_ADDR_T const program_break = sbrk(0);
-    assert(chunk <= program_break);
-    if (chunk == program_break)
-        return;
+    CHUNK_ADDR_T const next = *next_free(free_chunk);
+    CHUNK_ADDR_T const prev = *prev_free(free_chunk);
 
-    // Read the size and mask of the current chunk
-    CHUNK_SIZE_T size = get_size_from_beginning(chunk);
+    if (next)
+        *prev_free(next) = prev;
 
-    // If the P bit already had the same value, there is nothing to do
-    if ((size & 0x01) == p_bit_mask)
-        return;
+    if (prev)
+        *next_free(prev) = next;
+    else
+    {
+        const size_t index = bin_index(get_size_from_beginning(free_chunk) & ~CONTROL_MASK);
+        bins[index] = next;
+        if (!next)
+            bin_map[index / 64] &= ~(uint64_t(1) << (index % 64));
+    }
+}
 
-    // Update the P bit
-    size |= p_bit_mask;
+// Returns the first non-empty bin starting from index, or NUM_BINS if there is none
+inline size_t first_non_empty_bin(size_t index)
+{
+    for (size_t word = index / 64; word < NUM_BINS / 64; ++ word)
+    {
+        uint64_t bits = bin_map[word];
+        if (word == index / 64)
+            bits &= ~uint64_t(0) << (index % 64);
+        if (bits)
+            return word * 64 + __builtin_ctzll(bits);
+    }
+    return NUM_BINS;
+}
 
-    if (size & 0x02) // if this is a free chunk
-        set_size_free_chunk(chunk, size);
+// Returns a free chunk that can hold required_size, or NULL if there is none.
+CHUNK_ADDR_T find_free_chunk(size_t required_size)
+{
+    const size_t index = bin_index(required_size);
+    if (index < SMALL_BIN_LIMIT / MIN_ALIGNMENT)
+    {
+        // All the chunks in a small bin have the required size
+        if (bins[index])
+            return bins[index];
+    }
     else
-        set_size_at_beginning(chunk, size);
+    {
+        // The chunks in a large bin can be smaller
+        for (CHUNK_ADDR_T cur = bins[index]; cur; cur = *next_free(cur))
+            if ((get_size_from_beginning(cur) & ~CONTROL_MASK) >= required_size)
+                return cur;
+    }
+
+    // Any chunk in a bigger bin fits
+    const size_t bigger = first_non_empty_bin(index + 1);
+    return bigger < NUM_BINS ? bins[bigger] : NULL;
 }
 
-// Checks if the previous free chunk ends at the position where the current chunk starts.
-// If so, it means the previous chunk is free and updates the P bit in the mask of the current chunk.
-void update_mask_P_bit(CHUNK_ADDR_T prev_free_chunk, CHUNK_ADDR_T cur_chunk, CHUNK_SIZE_T& cur_mask)
+// Turns an allocated chunk into a free chunk, coalesced with its free neighbours,
+// and adds it to its bin.
+void release_chunk(CHUNK_ADDR_T chunk)
 {
-    if (prev_free_chunk)
+    const CHUNK_SIZE_T chunk_size = get_size_from_beginning(chunk);
+
+    // Check if we can coalesce the previous chunk
+    CHUNK_ADDR_T coalesced_start = chunk;
+    CHUNK_SIZE_T coalesced_size = chunk_size & ~CONTROL_MASK;
+    if (chunk_size & 0x01)
     {
-        const CHUNK_SIZE_T prev_size = get_size_from_beginning(prev_free_chunk) & ~CONTROL_MASK;
-        CHUNK_ADDR_T const prev_end = (CHUNK_ADDR_T const)(static_cast<char*>(prev_free_chunk) + prev_size);
+        const CHUNK_SIZE_T prev_size = get_size_from_prev_end(chunk) & ~CONTROL_MASK;
+        coalesced_start = (CHUNK_ADDR_T)(static_cast<char*>(chunk) - prev_size);
+        coalesced_size += prev_size;
+        unlink_free(coalesced_start);
+    }
 
-        if (prev_end == cur_chunk)
-            cur_mask |= 0x01;
+    // Check if we can coalesce the next chunk.
+    // The fencepost at the end of the region is never free.
+    CHUNK_ADDR_T next_chunk = (CHUNK_ADDR_T)(static_cast<char*>(coalesced_start) + coalesced_size);
+    const CHUNK_SIZE_T next_size = get_size_from_beginning(next_chunk);
+    if (next_size & 0x02)
+    {
+        unlink_free(next_chunk);
+        coalesced_size += next_size & ~CONTROL_MASK;
+        next_chunk = (CHUNK_ADDR_T)(static_cast<char*>(coalesced_start) + coalesced_size);
     }
+
+    // Update the metadata of the coalesced chunk.
+    // C is 1 because the current chunk is free.
+    // P is 0 because if the previous chunk were free, we would have coalesced it.
+    set_size_free_chunk(coalesced_start, coalesced_size | 0x02);
+
+    // Set the P bit of the next chunk, which is allocated because we coalesced it otherwise
+    set_size_at_beginning(next_chunk, get_size_from_beginning(next_chunk) | 0x01);
+
+    insert_free(coalesced_start);
 }
 
-// The mask contains the 2 least significant bits C and P
-CHUNK_ADDR_T alloc_sbrk(size_t size, size_t mask)
+// Adds a free chunk of at least required_size to the bins.
+// Returns false if the system fails.
+bool grow_heap(size_t required_size)
 {
-    // If SBRK_ALLOC_SIZE > size, we only want to create another free chunk from
-    // the extra space if there is enough memory to hold the new free chunk.
-    size_t allocated_size = size;
-    const size_t min_free_chunk_size = MIN_ALLOC_SIZE + sizeof(CHUNK_SIZE_T);
-    if (SBRK_ALLOC_SIZE > size + min_free_chunk_size)
+    // Leave room for the fencepost and for aligning both ends of the region
+    size_t allocated_size = required_size + sizeof(CHUNK_SIZE_T) + 2 * MIN_ALIGNMENT;
+    if (allocated_size < SBRK_ALLOC_SIZE)
         allocated_size = SBRK_ALLOC_SIZE;
 
-    void* allocated = sbrk(allocated_size);
+    char* const region = static_cast<char*>(sbrk(allocated_size));
+    if (region == (char*)-1)
+        return false;
 
-    if (allocated == (void*)-1)
-        return NULL;
+    CHUNK_ADDR_T chunk = (CHUNK_ADDR_T)next_aligned((size_t)region);
+    CHUNK_SIZE_T mask = 0x00;
+    if (heap_end && region == static_cast<char*>(heap_end) + sizeof(CHUNK_SIZE_T))
+    {
+        // The region continues the heap, so the new chunk starts at the old
+        // fencepost and keeps its P bit to coalesce with a free last chunk.
+        chunk = heap_end;
+        mask = get_size_from_beginning(heap_end) & 0x01;
+    }
 
-    // Create a free chunk from the allocated memory
-    set_size_free_chunk(allocated, allocated_size | mask);
-    mark_last_free(allocated);
+    // The fencepost is allocated and has size 0
+    heap_end = (CHUNK_ADDR_T)(((size_t)(region + allocated_size) - sizeof(CHUNK_SIZE_T)) & ~CONTROL_MASK);
+    set_size_at_beginning(heap_end, 0x00);
 
-    return allocated;
+    // Free the new chunk as if it had been allocated
+    const CHUNK_SIZE_T chunk_size = static_cast<char*>(heap_end) - static_cast<char*>(chunk);
+    set_size_at_beginning(chunk, chunk_size | mask);
+    release_chunk(chunk);
+    return true;
 }
 
-// Assumes that cur_chunk has enough space to hold the requested size.
-// Potentially breaks cur_chunk into an allocated chunk and a free chunk.
-//  Adds the free chunk to the free chunk list and returns the address of
-//  the allocated space in the allocated chunk.
-void* split(CHUNK_ADDR_T cur_chunk, size_t required_size, CHUNK_ADDR_T prev_free_chunk)
+// Takes free_chunk out of its bin and potentially breaks it into an allocated
+// chunk and a free chunk. Adds the free chunk to its bin and returns the
+// address of the allocated space in the allocated chunk.
+void* split(CHUNK_ADDR_T free_chunk, size_t required_size)
 {
     // Confirm that we have enough space for the allocated chunk.
     // The chunk size also includes the overhead.
-    CHUNK_SIZE_T chunk_size = get_size_from_beginning(cur_chunk) & ~CONTROL_MASK;
+    const CHUNK_SIZE_T chunk_size = get_size_from_beginning(free_chunk) & ~CONTROL_MASK;
     assert(chunk_size >= required_size);
+    unlink_free(free_chunk);
 
-    // Set the size and mask of the allocated chunk.
-    // C will 0 because it's an allocated chunk.
-    CHUNK_SIZE_T allocated_size_mask = 0x00;
-    // To find P, we check if previous free chunk is also the previous chunk.
-    update_mask_P_bit(prev_free_chunk, cur_chunk, allocated_size_mask);
-    set_size_at_beginning(cur_chunk, required_size | allocated_size_mask);
-
-    // If this was the only free chunk, update first_free_chunk
-    const bool was_first_free_chunk = (cur_chunk == first_free_chunk);
-    if (was_first_free_chunk)
-        first_free_chunk = *next_free(first_free_chunk);
-
-    // The current chunk is not free, so next's P bit will be 0
-    CHUNK_SIZE_T next_P_bit = 0x00;
-    bool updated_prev_free_next = false;
-    if (chunk_size > required_size)
+    // C will be 0 because it's an allocated chunk.
+    // P will be 0 because a free chunk never follows another free chunk.
+    const size_t remaining_size = chunk_size - required_size;
+    if (remaining_size >= MIN_ALLOC_SIZE + sizeof(CHUNK_SIZE_T))
     {
-        // Try to create a free chunk from the remaining space
-        const size_t remaining_size = chunk_size - required_size;
-        // Try to fit a free chunk, otherwise this space will be wasted
-        if (remaining_size >= MIN_ALLOC_SIZE + sizeof(CHUNK_SIZE_T))
-        {
-            // The next chunk will have a free chunk as the previous chunk
-            next_P_bit = 0x01;
-
-            // Set the size including the overhead of the new free chunk
-            CHUNK_ADDR_T free_chunk = (CHUNK_ADDR_T)(static_cast<char*>(cur_chunk) + required_size);
-            // C will 1 because it's a free chunk.
-            // P will be 0, because the previous chunk is allocated.
-            const CHUNK_SIZE_T free_chunk_size_mask = 0x02;
-            set_size_free_chunk(free_chunk, remaining_size | free_chunk_size_mask);
-
-            // Set the pointer to the next free chunk
-            *next_free(free_chunk) = *next_free(cur_chunk);
-
-            // Update the next pointer of the previous free chunk
-            if (prev_free_chunk != NULL)
-                *next_free(prev_free_chunk) = free_chunk;
-            updated_prev_free_next = true;
-
-            if (was_first_free_chunk)
-                first_free_chunk = free_chunk;
-        }
-    }
+        set_size_at_beginning(free_chunk, required_size);
 
-    // Update the next pointer of the previous last free chunk if we haven't already
-    if (!updated_prev_free_next && prev_free_chunk != NULL)
-        *next_free(prev_free_chunk) = *next_free(cur_chunk);
+        // The next chunk keeps its P bit, it now follows the remaining free chunk
+        CHUNK_ADDR_T remaining = (CHUNK_ADDR_T)(static_cast<char*>(free_chunk) + required_size);
+        set_size_free_chunk(remaining, remaining_size | 0x02);
+        insert_free(remaining);
+    }
+    else
+    {
+        // The remaining space can't fit a free chunk, so it's wasted
+        set_size_at_beginning(free_chunk, chunk_size);
 
-    // Update the P pointer of the next chunk
-    CHUNK_ADDR_T next_chunk = (CHUNK_ADDR_T)(static_cast<char*>(cur_chunk) + chunk_size);
-    update_chunk_P_bit(next_chunk, next_P_bit);
+        CHUNK_ADDR_T next_chunk = (CHUNK_ADDR_T)(static_cast<char*>(free_chunk) + chunk_size);
+        set_size_at_beginning(next_chunk, get_size_from_beginning(next_chunk) & ~0x01);
+    }
 
-    void* user_allocated = (void*)(static_cast<char*>(cur_chunk) + sizeof(CHUNK_SIZE_T));
+    void* user_allocated = (void*)(static_cast<char*>(free_chunk) + sizeof(CHUNK_SIZE_T));
     return user_allocated;
 }
 
@@ -266,47 +350,18 @@ void* malloc(size_t size)
         size = MIN_ALLOC_SIZE;
     const size_t required_size = next_aligned(size + sizeof(CHUNK_SIZE_T));
 
-    // If there is no free memory, try to allocate and return if system fails
-    if (! first_free_chunk)
+    CHUNK_ADDR_T chunk = find_free_chunk(required_size);
+    if (!chunk)
     {
-        // C is 1 because the new chunk will be free
-        // P is 0 because there are no other free chunks
-        CHUNK_ADDR_T chunk = alloc_sbrk(required_size, 0x02);
-        if (chunk == NULL)
+        // If there is not enough free memory, try to allocate and return if system fails
+        if (!grow_heap(required_size))
             return NULL;
 
-        first_free_chunk = chunk;
-    }
-
-    // Find the first free chunk that contains enough memory to fit the request
-    CHUNK_ADDR_T cur_free = first_free_chunk;
-    CHUNK_ADDR_T prev_free = NULL;
-    while ((get_size_from_beginning(cur_free) & ~CONTROL_MASK) < required_size)
-    {
-        prev_free = cur_free;
-        cur_free = *next_free(cur_free);
-
-        // If this is the last chunk, try to allocate memory and return if system fails
-        if (cur_free == NULL)
-        {
-            // C is 1 because the new chunk will be free.
-            CHUNK_SIZE_T mask = 0x02;
-            // To find P (if the previous chunk was free), we check if prev_free is also
-            // the previous chunk (last one, since we are allocating at the end).
-            CHUNK_ADDR_T const program_break = sbrk(0);
-            update_mask_P_bit(prev_free, program_break, mask);
-
-            cur_free = alloc_sbrk(required_size, mask);
-            if (cur_free == NULL)
-                return NULL;
-
-            // Update the next pointer of the previous free chunk
-            *next_free(prev_free) = cur_free;
-            break;
-        }
+        chunk = find_free_chunk(required_size);
+        assert(chunk);
     }
 
-    return split(cur_free, required_size, prev_free);
+    return split(chunk, required_size);
 }
 
 // Undefined behaviour if we call free on a pointer that was not returned
@@ -316,90 +371,7 @@ void free(void* ptr)
     if (!ptr)
         return;
 
-    // Check if we can coalesce the previous chunk
-    CHUNK_ADDR_T chunk = (CHUNK_ADDR_T)(static_cast<char*>(ptr) - sizeof(CHUNK_SIZE_T));
-    const CHUNK_SIZE_T chunk_size = get_size_from_beginning(chunk);
-
-    CHUNK_ADDR_T coalesced_start = chunk;
-    CHUNK_SIZE_T coalesced_size = chunk_size & ~CONTROL_MASK;
-    if (chunk_size & 0x01)
-    {
-        const CHUNK_SIZE_T prev_size = get_size_from_prev_end(chunk) & ~CONTROL_MASK;
-        coalesced_start = (CHUNK_ADDR_T)(static_cast<char*>(chunk) - prev_size);
-        coalesced_size += prev_size;
-    }
-
-    // Check if we can coalesce the next chunk
-    CHUNK_ADDR_T next_chunk = (CHUNK_ADDR_T)(static_cast<char*>(coalesced_start) + coalesced_size);
-    CHUNK_ADDR_T const program_break = sbrk(0);
-    assert(next_chunk <= program_break);
-
-    CHUNK_ADDR_T coalesced_end = next_chunk;
-    if (next_chunk < program_break)
-    {
-        CHUNK_SIZE_T next_size = get_size_from_beginning(next_chunk);
-        if (next_size & 0x02)
-        {
-            // remove the mask
-            next_size = next_size & ~CONTROL_MASK;
-            // update the coalesced end and size
-            coalesced_end = (CHUNK_ADDR_T)(static_cast<char*>(coalesced_end) + next_size);
-            coalesced_size += next_size;
-        }
-    }
-
-    // Update the metadata of the coalesced chunk.
-    // C is 1 because the current chunk is free.
-    // P is 0 because if the previous chunk were free, we would have coalesced it.
-    set_size_free_chunk(coalesced_start, coalesced_size | 0x02);
-
-    // Set the P bit of the next chunk because this is a free chunk
-    update_chunk_P_bit(coalesced_end, 0x01);
-
-    // Update first_free_chunk and the current chunk's next free pointer
-    if (!first_free_chunk)
-    {
-        first_free_chunk = coalesced_start;
-        mark_last_free(first_free_chunk);
-        *next_free(coalesced_start) = NULL;
-    }
-    else if (coalesced_start < first_free_chunk)
-    {
-        *next_free(coalesced_start) = first_free_chunk;
-        first_free_chunk = coalesced_start;
-    }
-    else if (coalesced_start == first_free_chunk)
-    {
-        *next_free(coalesced_start) = *next_free(first_free_chunk);
-        first_free_chunk = coalesced_start;
-    }
-    else // coalesced_start > *first_free_chunk
-    {
-        // Update the previous free chunk's next pointer.
-        // Maybe this could be improved so we don't have to walk the entire free chunk list.
-        CHUNK_ADDR_T cur = *next_free(first_free_chunk);
-        CHUNK_ADDR_T prev = first_free_chunk;
-        bool updated_prev_free_next = false;
-        while (cur)
-        {
-            if (cur > coalesced_start)
-            {
-                *next_free(prev) = coalesced_start;
-                updated_prev_free_next = true;
-                break;
-            }
-
-            prev = cur;
-            cur = next_free(cur);
-        }
-
-        // If this is the last free chunk
-        if (!updated_prev_free_next)
-        {
-            *next_free(prev) = coalesced_start;
-            mark_last_free(coalesced_start);
-        }
-    }
+    release_chunk((CHUNK_ADDR_T)(static_cast<char*>(ptr) - sizeof(CHUNK_SIZE_T)));
 }
 
 } // namespace si
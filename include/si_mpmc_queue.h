@@ -0,0 +1,341 @@
+#ifndef SI_MPMC_QUEUE_H
+#define SI_MPMC_QUEUE_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <immintrin.h> // for _mm_pause
+#include <memory>
+#include <mutex>
+#include <new>
+#include <optional>
+#include <thread>
+#include <type_traits>
+#include <utility>
+
+namespace si {
+
+// Bounded lock-free multiple-producer multiple-consumer queue by Dmitry Vyukov.
+// https://www.1024cores.net/home/lock-free-algorithms/queues/bounded-mpmc-queue
+//
+// Each cell has a sequence number that tells whose turn it is:
+// - seq == pos:     empty, the producer that claims position pos can write it
+// - seq == pos + 1: full, the consumer that claims position pos can read it
+// Producers and consumers claim positions with a CAS on their own counter and
+// then only touch the claimed cell, so they only contend with their own kind.
+// Pushing to a full queue or popping from an empty one fails right away.
+//
+// T must be nothrow move constructible, a claimed cell can't be given back.
+template <class T>
+class mpmc_queue
+{
+    static_assert(std::is_nothrow_move_constructible<T>::value,
+                  "T must be nothrow move constructible");
+
+public:
+    // The capacity is rounded up to a power of two (at least 2).
+    explicit mpmc_queue(size_t capacity)
+        : d_mask(round_up(capacity) - 1)
+        , d_cells(new cell[d_mask + 1])
+    {
+        for (size_t i = 0; i <= d_mask; ++ i)
+            d_cells[i].seq.store(i, std::memory_order_relaxed);
+    }
+
+    mpmc_queue(const mpmc_queue&) = delete;
+    mpmc_queue& operator= (const mpmc_queue&) = delete;
+
+    // Assumes no other thread is using the queue anymore.
+    ~mpmc_queue()
+    {
+        const size_t tail = d_tail.load(std::memory_order_relaxed);
+        for (size_t pos = d_head.load(std::memory_order_relaxed); pos != tail; ++ pos)
+            d_cells[pos & d_mask].value()->~T();
+    }
+
+    // Returns false if the queue is full, val is only moved from on success.
+    bool try_push(const T& val)
+    {
+        return try_emplace(val);
+    }
+
+    bool try_push(T&& val)
+    {
+        return try_emplace(std::move(val));
+    }
+
+    // The arguments are only forwarded once a cell was claimed. If the
+    // constructor can throw, the value is constructed up front instead.
+    template <typename ... Args>
+    bool try_emplace(Args&&... args)
+    {
+        if constexpr (!std::is_nothrow_constructible<T, Args&&...>::value)
+        {
+            if (full())
+                return false;
+            return try_emplace(T(std::forward<Args>(args)...));
+        }
+        else
+        {
+            size_t pos;
+            cell* c = claim(d_tail, 0, pos);
+            if (!c)
+                return false;
+
+            new (&c->storage) T(std::forward<Args>(args)...);
+            c->seq.store(pos + 1, std::memory_order_release);
+            return true;
+        }
+    }
+
+    // Returns false if the queue is empty.
+    bool try_pop(T& result)
+    {
+        size_t pos;
+        cell* c = claim(d_head, 1, pos);
+        if (!c)
+            return false;
+
+        result = std::move(*c->value());
+        release(c, pos);
+        return true;
+    }
+
+    std::optional<T> try_pop()
+    {
+        size_t pos;
+        cell* c = claim(d_head, 1, pos);
+        if (!c)
+            return std::nullopt;
+
+        std::optional<T> res(std::move(*c->value()));
+        release(c, pos);
+        return res;
+    }
+
+    // Only a snapshot, other threads might change it right away.
+    bool empty() const noexcept
+    {
+        const size_t head = d_head.load(std::memory_order_acquire);
+        return d_cells[head & d_mask].seq.load(std::memory_order_acquire) != head + 1;
+    }
+
+    bool full() const noexcept
+    {
+        const size_t tail = d_tail.load(std::memory_order_acquire);
+        return d_cells[tail & d_mask].seq.load(std::memory_order_acquire) != tail;
+    }
+
+    size_t capacity() const noexcept
+    {
+        return d_mask + 1;
+    }
+
+private:
+    struct cell
+    {
+        std::atomic<size_t> seq;
+        alignas(T) unsigned char storage[sizeof(T)];
+
+        T* value() noexcept
+        {
+            return std::launder(reinterpret_cast<T*>(&storage));
+        }
+    };
+
+    static size_t round_up(size_t capacity) noexcept
+    {
+        size_t res = 2;
+        while (res < capacity)
+            res <<= 1;
+        return res;
+    }
+
+    // Claims the cell at the current position of counter, which is ready
+    // when its seq is pos + offset. Returns nullptr if the cell isn't ready
+    // (the queue is full for producers, empty for consumers).
+    cell* claim(std::atomic<size_t>& counter, size_t offset, size_t& pos) noexcept
+    {
+        pos = counter.load(std::memory_order_relaxed);
+        for (;;)
+        {
+            cell* c = &d_cells[pos & d_mask];
+            const size_t seq = c->seq.load(std::memory_order_acquire);
+            const intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos + offset);
+            if (diff == 0)
+            {
+                if (counter.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                    return c;
+            }
+            else if (diff < 0)
+                return nullptr;
+            else
+                pos = counter.load(std::memory_order_relaxed);
+        }
+    }
+
+    // Hands the cell over to the producer one lap ahead.
+    void release(cell* c, size_t pos) noexcept
+    {
+        c->value()->~T();
+        c->seq.store(pos + d_mask + 1, std::memory_order_release);
+    }
+
+    const size_t            d_mask;
+    std::unique_ptr<cell[]> d_cells;
+
+    // Each counter is on its own cache line, so producers and consumers
+    // don't invalidate each other's counter.
+    alignas(64) std::atomic<size_t> d_tail{0};
+    alignas(64) std::atomic<size_t> d_head{0};
+};
+
+// Blocking version of mpmc_queue. push and pop spin for a short while and
+// then sleep on a condition variable. Threads only take the mutex to sleep
+// or to wake up sleepers, so the fast path stays lock-free.
+template <class T>
+class blocking_mpmc_queue
+{
+public:
+    explicit blocking_mpmc_queue(size_t capacity)
+        : d_queue(capacity)
+    {}
+
+    blocking_mpmc_queue(const blocking_mpmc_queue&) = delete;
+    blocking_mpmc_queue& operator= (const blocking_mpmc_queue&) = delete;
+
+    // Blocks while the queue is full.
+    void push(const T& val)
+    {
+        push(T(val));
+    }
+
+    void push(T&& val)
+    {
+        if (!spin([&]() { return d_queue.try_push(std::move(val)); }))
+        {
+            std::unique_lock<std::mutex> ulock(d_mutex);
+            wait(ulock, d_push_waiters, d_not_full, [&]() { return d_queue.try_push(std::move(val)); });
+        }
+        wake(d_pop_waiters, d_not_empty);
+    }
+
+    template <typename ... Args>
+    void emplace(Args&&... args)
+    {
+        push(T(std::forward<Args>(args)...));
+    }
+
+    bool try_push(const T& val)
+    {
+        return try_push(T(val));
+    }
+
+    bool try_push(T&& val)
+    {
+        if (!d_queue.try_push(std::move(val)))
+            return false;
+
+        wake(d_pop_waiters, d_not_empty);
+        return true;
+    }
+
+    // Blocks while the queue is empty.
+    void pop(T& result)
+    {
+        if (!spin([&]() { return d_queue.try_pop(result); }))
+        {
+            std::unique_lock<std::mutex> ulock(d_mutex);
+            wait(ulock, d_pop_waiters, d_not_empty, [&]() { return d_queue.try_pop(result); });
+        }
+        wake(d_push_waiters, d_not_full);
+    }
+
+    T pop()
+    {
+        std::optional<T> res;
+        if (!spin([&]() { return (res = d_queue.try_pop()).has_value(); }))
+        {
+            std::unique_lock<std::mutex> ulock(d_mutex);
+            wait(ulock, d_pop_waiters, d_not_empty, [&]() { return (res = d_queue.try_pop()).has_value(); });
+        }
+        wake(d_push_waiters, d_not_full);
+        return std::move(*res);
+    }
+
+    bool try_pop(T& result)
+    {
+        if (!d_queue.try_pop(result))
+            return false;
+
+        wake(d_push_waiters, d_not_full);
+        return true;
+    }
+
+    bool empty() const noexcept
+    {
+        return d_queue.empty();
+    }
+
+    size_t capacity() const noexcept
+    {
+        return d_queue.capacity();
+    }
+
+private:
+    static constexpr unsigned spin_count = 16;
+    static constexpr unsigned yield_count = 16;
+
+    // Spins briefly, then yields in case the other side runs on the same core.
+    template <typename F>
+    static bool spin(F try_op)
+    {
+        for (unsigned i = 0; i < spin_count + yield_count; ++ i)
+        {
+            if (try_op())
+                return true;
+            if (i < spin_count)
+                _mm_pause();
+            else
+                std::this_thread::yield();
+        }
+        return false;
+    }
+
+    // The fences in wait() and wake() pair up: either the waiter sees the
+    // change made by the waker, or the waker sees the waiter and notifies it.
+    // The waker takes the mutex, so the waiter is either still before its
+    // last check or already inside wait().
+    template <typename F>
+    static void wait(std::unique_lock<std::mutex>& ulock, std::atomic<unsigned>& waiters,
+                     std::condition_variable& cond, F try_op)
+    {
+        waiters.fetch_add(1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        cond.wait(ulock, try_op);
+        waiters.fetch_sub(1, std::memory_order_relaxed);
+    }
+
+    void wake(std::atomic<unsigned>& waiters, std::condition_variable& cond)
+    {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (waiters.load(std::memory_order_relaxed) == 0)
+            return;
+
+        { std::lock_guard<std::mutex> guard(d_mutex); }
+        cond.notify_one();
+    }
+
+    mpmc_queue<T>           d_queue;
+
+    std::mutex              d_mutex;
+    std::condition_variable d_not_empty;
+    std::condition_variable d_not_full;
+    std::atomic<unsigned>   d_pop_waiters{0};
+    std::atomic<unsigned>   d_push_waiters{0};
+};
+
+} // namespace si
+
+#endif
@@ -0,0 +1,177 @@
+#ifndef SI_NODE_FREELIST_H
+#define SI_NODE_FREELIST_H
+
+#include <si_tagged_ptr.h>
+
+#include <atomic>
+#include <cstddef>
+#include <new>
+#include <utility>
+
+namespace si {
+
+// Lock-free pool of Node objects. Destroyed nodes are pushed onto a free list
+// and their memory is reused by the next create(), so once the pool has grown
+// to the peak number of live nodes there are no more allocations.
+//
+// The memory of a node is only given back to the system when the pool is
+// destroyed (type-stable memory). Each block also has a link word outside the
+// node, created with the block and never destroyed or constructed again. The
+// free list links the blocks through it, and a lock-free container can use it
+// as the link of its live nodes (see link()). A thread that lost a race may
+// still read the word after the node was destroyed or recreated. It gets a
+// stale pointer, which is fine when its tagged CAS is about to fail anyway.
+// Nothing else of a destroyed node may be read.
+template <typename Node>
+class node_freelist
+{
+public:
+    node_freelist() = default;
+
+    node_freelist(const node_freelist&) = delete;
+    node_freelist& operator= (const node_freelist&) = delete;
+
+    // Assumes all the nodes were destroyed.
+    ~node_freelist()
+    {
+        block* cur = d_head.load().get();
+        while (cur)
+        {
+            block* next = static_cast<block*>(cur->link.load(std::memory_order_relaxed));
+            delete cur;
+            cur = next;
+        }
+    }
+
+    template <typename ... Args>
+    Node* create(Args&&... args)
+    {
+        block* b = pop();
+        if (!b)
+            b = new block;
+
+        try
+        {
+            return new (&b->storage) Node(std::forward<Args>(args)...);
+        }
+        catch (...)
+        {
+            push(b);
+            throw;
+        }
+    }
+
+    void destroy(Node* node) noexcept
+    {
+        node->~Node();
+        push(to_block(node));
+    }
+
+    // The link word of the block of node, which may have been destroyed.
+    // Only meaningful to the container while node is alive, and overwritten
+    // by the free list once it's destroyed.
+    static std::atomic<void*>& link(Node* node) noexcept
+    {
+        return to_block(node)->link;
+    }
+
+private:
+    struct block
+    {
+        // Atomic because racing threads can read it while the block is reused.
+        std::atomic<void*> link{nullptr};
+        alignas(Node) unsigned char storage[sizeof(Node)];
+    };
+
+    static block* to_block(Node* node) noexcept
+    {
+        return reinterpret_cast<block*>(reinterpret_cast<char*>(node) - offsetof(block, storage));
+    }
+
+    void push(block* b) noexcept
+    {
+        tagged_ptr<block> old_head = d_head.load(std::memory_order_relaxed);
+        do
+        {
+            b->link.store(old_head.get(), std::memory_order_relaxed);
+        } while (!d_head.compare_exchange_weak(old_head, tagged_ptr<block>(b, old_head.tag() + 1),
+                                               std::memory_order_release,
+                                               std::memory_order_relaxed));
+    }
+
+    block* pop() noexcept
+    {
+        tagged_ptr<block> old_head = d_head.load(std::memory_order_acquire);
+        while (old_head
+               && !d_head.compare_exchange_weak(old_head,
+                       tagged_ptr<block>(static_cast<block*>(old_head->link.load(std::memory_order_relaxed)),
+                                         old_head.tag() + 1),
+                       std::memory_order_acquire,
+                       std::memory_order_acquire));
+        return old_head.get();
+    }
+
+    std::atomic<tagged_ptr<block>> d_head{tagged_ptr<block>()};
+};
+
+// Reclamation policy for the lock-free containers, see epoch_reclamation.
+// Popped nodes are recycled right away instead of being freed, so there
+// are no allocations in steady state. This is only correct for containers
+// whose links are tagged_ptrs (no ABA) and that read nothing from nodes that
+// might have been popped by other threads, except their link().
+struct freelist_reclamation
+{
+    // Tells the containers to keep their links in the pool blocks
+    static constexpr bool links_in_pool = true;
+
+    template <typename Node>
+    class reclaimer
+    {
+    public:
+        template <typename ... Args>
+        Node* create(Args&&... args)
+        {
+            return d_pool.create(std::forward<Args>(args)...);
+        }
+
+        void destroy(Node* node)
+        {
+            d_pool.destroy(node);
+        }
+
+        static std::atomic<void*>& link(Node* node) noexcept
+        {
+            return node_freelist<Node>::link(node);
+        }
+
+        class guard
+        {
+        public:
+            explicit guard(reclaimer& r)
+                : d_reclaimer(r)
+            {}
+
+            // Nodes are never freed, just reused.
+            template <typename P>
+            P protect(const std::atomic<P>& src)
+            {
+                return src.load();
+            }
+
+            void retire(Node* node)
+            {
+                d_reclaimer.destroy(node);
+            }
+
+        private:
+            reclaimer& d_reclaimer;
+        };
+
+    private:
+        node_freelist<Node> d_pool;
+    };
+};
+
+} // namespace si
+
+#endif
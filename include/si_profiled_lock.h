@@ -0,0 +1,309 @@
+#ifndef SI_PROFILED_LOCK_H
+#define SI_PROFILED_LOCK_H
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cstdint>
+#include <immintrin.h> // for _mm_pause
+#include <map>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <vector>
+#include <x86intrin.h> // for __rdtsc
+
+namespace si {
+
+// Counters of one profiled_lock. Only updated while holding the lock, so
+// the owner of an exclusive lock bumps them without a locked instruction.
+// They are still atomics so the registry can read them at any time.
+struct lock_stats
+{
+    // Histograms of cycles, bucket b counts durations in [2^(b-1), 2^b)
+    static constexpr size_t num_buckets = 48;
+
+    std::atomic<uint64_t> acquisitions{0};
+    std::atomic<uint64_t> contended{0};
+    // Failed try_lock calls before getting the lock
+    std::atomic<uint64_t> spins{0};
+    // Of the contended acquisitions only
+    std::atomic<uint64_t> wait_cycles[num_buckets]{};
+    // Of a sample of the exclusive acquisitions, shared holds overlap
+    std::atomic<uint64_t> hold_cycles[num_buckets]{};
+
+    static size_t bucket(uint64_t cycles) noexcept
+    {
+        return std::min<size_t>(std::bit_width(cycles), num_buckets - 1);
+    }
+
+    // Exclusive holders are alone, shared holders need the atomic add.
+    static void add(std::atomic<uint64_t>& counter, uint64_t n, bool exclusive) noexcept
+    {
+        if (exclusive)
+            counter.store(counter.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+        else
+            counter.fetch_add(n, std::memory_order_relaxed);
+    }
+};
+
+// The sum of the stats of all the locks of one site, live or destroyed.
+struct lock_site_stats
+{
+    std::string site;
+    uint64_t    acquisitions = 0;
+    uint64_t    contended = 0;
+    uint64_t    spins = 0;
+    uint64_t    wait_cycles[lock_stats::num_buckets] = {};
+    uint64_t    hold_cycles[lock_stats::num_buckets] = {};
+
+    void merge(const lock_stats& stats) noexcept
+    {
+        acquisitions += stats.acquisitions.load(std::memory_order_relaxed);
+        contended += stats.contended.load(std::memory_order_relaxed);
+        spins += stats.spins.load(std::memory_order_relaxed);
+        for (size_t b = 0; b < lock_stats::num_buckets; ++ b)
+        {
+            wait_cycles[b] += stats.wait_cycles[b].load(std::memory_order_relaxed);
+            hold_cycles[b] += stats.hold_cycles[b].load(std::memory_order_relaxed);
+        }
+    }
+
+    // Upper bound in cycles of the bucket holding the p-th percentile (0 to 1)
+    static uint64_t percentile(const uint64_t (&histogram)[lock_stats::num_buckets], double p) noexcept
+    {
+        uint64_t total = 0;
+        for (uint64_t count : histogram)
+            total += count;
+
+        uint64_t seen = 0;
+        for (size_t b = 0; b < lock_stats::num_buckets; ++ b)
+        {
+            seen += histogram[b];
+            if (total && seen >= p * total)
+                return uint64_t(1) << b;
+        }
+        return 0;
+    }
+};
+
+// Knows every profiled_lock by the name of its site, e.g. all the bucket
+// locks of a map share one site. The stats of destroyed locks are kept.
+class lock_registry
+{
+public:
+    static lock_registry& instance()
+    {
+        static lock_registry registry;
+        return registry;
+    }
+
+    void add(const std::string& site, const lock_stats* stats)
+    {
+        std::lock_guard<std::mutex> guard(d_mutex);
+        d_sites[site].live.push_back(stats);
+    }
+
+    void remove(const std::string& site, const lock_stats* stats)
+    {
+        std::lock_guard<std::mutex> guard(d_mutex);
+        entry& e = d_sites[site];
+        e.retired.merge(*stats);
+        e.live.erase(std::find(e.live.begin(), e.live.end(), stats));
+    }
+
+    // All zeros for an unknown site
+    lock_site_stats site(const std::string& name) const
+    {
+        std::lock_guard<std::mutex> guard(d_mutex);
+        const auto it = d_sites.find(name);
+        return it == d_sites.end() ? lock_site_stats{name} : collect(it->first, it->second);
+    }
+
+    std::vector<lock_site_stats> sites() const
+    {
+        std::lock_guard<std::mutex> guard(d_mutex);
+        std::vector<lock_site_stats> result;
+        for (const auto& [name, e] : d_sites)
+            result.push_back(collect(name, e));
+        return result;
+    }
+
+    // One line per site, the hottest sites first
+    void dump(std::ostream& os) const
+    {
+        std::vector<lock_site_stats> stats = sites();
+        std::sort(stats.begin(), stats.end(), [](const lock_site_stats& a, const lock_site_stats& b) {
+            return a.contended > b.contended;
+        });
+
+        for (const lock_site_stats& s : stats)
+            os << s.site << ": acquisitions = " << s.acquisitions
+               << "; contended = " << s.contended
+               << " (" << (s.acquisitions ? 100.0 * s.contended / s.acquisitions : 0) << "%)"
+               << "; spins = " << s.spins
+               << "; wait p50/p99 < " << lock_site_stats::percentile(s.wait_cycles, 0.5)
+               << "/" << lock_site_stats::percentile(s.wait_cycles, 0.99) << " cycles"
+               << "; hold p50/p99 < " << lock_site_stats::percentile(s.hold_cycles, 0.5)
+               << "/" << lock_site_stats::percentile(s.hold_cycles, 0.99) << " cycles" << '\n';
+    }
+
+private:
+    struct entry
+    {
+        lock_site_stats                retired;
+        std::vector<const lock_stats*> live;
+    };
+
+    static lock_site_stats collect(const std::string& name, const entry& e)
+    {
+        lock_site_stats result = e.retired;
+        result.site = name;
+        for (const lock_stats* stats : e.live)
+            result.merge(*stats);
+        return result;
+    }
+
+    mutable std::mutex           d_mutex;
+    std::map<std::string, entry> d_sites;
+};
+
+// A string literal as a template argument: profiled_lock<std::mutex, "orders">
+template <size_t N>
+struct site_name
+{
+    constexpr site_name(const char (&str)[N])
+    {
+        std::copy_n(str, N, value);
+    }
+
+    char value[N];
+};
+
+// Wraps any Lockable (or SharedLockable) and records in lock_registry how
+// often it's taken and contended, how long threads wait for it and how long
+// they hold it, timed with rdtsc.
+//
+// An uncontended lock() costs a try_lock and a few plain stores, the hold
+// time is only sampled. A contended one is always timed, and retries
+// try_lock up to spin_tries times, counting the spins, before blocking in
+// Lock::lock().
+//
+// The site is given by the Site template argument, so the locks inside a
+// container can be profiled: threadsafe_queue<T, profiled_lock<std::mutex, "jobs">>.
+// Standalone locks can also be named at run time.
+template <typename Lock, site_name Site = "unnamed">
+class profiled_lock
+{
+public:
+    profiled_lock()
+        : profiled_lock(Site.value)
+    {}
+
+    explicit profiled_lock(std::string site)
+        : d_site(std::move(site))
+    {
+        lock_registry::instance().add(d_site, &d_stats);
+    }
+
+    profiled_lock(const profiled_lock&) = delete;
+    profiled_lock& operator= (const profiled_lock&) = delete;
+
+    ~profiled_lock()
+    {
+        lock_registry::instance().remove(d_site, &d_stats);
+    }
+
+    void lock()
+    {
+        if (!d_lock.try_lock())
+            wait([this]() { return d_lock.try_lock(); }, [this]() { d_lock.lock(); }, true);
+        acquired();
+    }
+
+    bool try_lock()
+    {
+        if (!d_lock.try_lock())
+            return false;
+        acquired();
+        return true;
+    }
+
+    void unlock()
+    {
+        if (d_acquired_at)
+            lock_stats::add(d_stats.hold_cycles[lock_stats::bucket(__rdtsc() - d_acquired_at)], 1, true);
+        d_lock.unlock();
+    }
+
+    void lock_shared() requires requires (Lock& l) { l.lock_shared(); }
+    {
+        if (!d_lock.try_lock_shared())
+            wait([this]() { return d_lock.try_lock_shared(); }, [this]() { d_lock.lock_shared(); }, false);
+        lock_stats::add(d_stats.acquisitions, 1, false);
+    }
+
+    bool try_lock_shared() requires requires (Lock& l) { l.try_lock_shared(); }
+    {
+        if (!d_lock.try_lock_shared())
+            return false;
+        lock_stats::add(d_stats.acquisitions, 1, false);
+        return true;
+    }
+
+    void unlock_shared() requires requires (Lock& l) { l.unlock_shared(); }
+    {
+        d_lock.unlock_shared();
+    }
+
+    const std::string& site() const noexcept
+    {
+        return d_site;
+    }
+
+private:
+    static constexpr uint64_t spin_tries = 64;
+    // rdtsc costs as much as an uncontended lock, so only one exclusive
+    // hold in hold_sample_rate is timed
+    static constexpr uint64_t hold_sample_rate = 16;
+
+    void acquired() noexcept
+    {
+        const uint64_t n = d_stats.acquisitions.load(std::memory_order_relaxed);
+        d_stats.acquisitions.store(n + 1, std::memory_order_relaxed);
+        d_acquired_at = n % hold_sample_rate == 0 ? __rdtsc() : 0;
+    }
+
+    // Called after a failed try, returns holding the lock
+    template <typename Try, typename Block>
+    void wait(Try try_again, Block block, bool exclusive)
+    {
+        const uint64_t start = __rdtsc();
+        uint64_t spins = 1;
+        for (;; ++ spins)
+        {
+            if (spins == spin_tries)
+            {
+                block();
+                break;
+            }
+            _mm_pause();
+            if (try_again())
+                break;
+        }
+
+        lock_stats::add(d_stats.contended, 1, exclusive);
+        lock_stats::add(d_stats.spins, spins, exclusive);
+        lock_stats::add(d_stats.wait_cycles[lock_stats::bucket(__rdtsc() - start)], 1, exclusive);
+    }
+
+    Lock        d_lock;
+    // Only accessed by the exclusive owner
+    uint64_t    d_acquired_at = 0;
+    lock_stats  d_stats;
+    std::string d_site;
+};
+
+} // namespace si
+
+#endif
@@ -0,0 +1,191 @@
+#ifndef SI_RECORD_RING_BUFFER_H
+#define SI_RECORD_RING_BUFFER_H
+
+#include <si_ring_buffer.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+
+namespace si {
+
+// Contiguous bytes of a record inside a record_ring_buffer.
+struct record_view
+{
+    const char* data = nullptr;
+    size_t      size = 0;
+
+    explicit operator bool() const noexcept { return data != nullptr; }
+};
+
+// Ring buffer of variable-length byte records for a single producer and a
+// single consumer, built on top of spsc_ring_buffer.
+//
+// Each record is a header holding its size, followed by its bytes padded to
+// a multiple of 8, so every record starts 8 byte aligned. A record is never
+// split: when it doesn't fit before the end of the storage, the producer
+// writes a skip marker that covers the rest of the storage, and the record
+// goes at the beginning instead. With mirrored_storage there is never a need
+// for skip markers.
+//
+// There are no allocations per record, records are written and read in
+// place through reserve()/commit() and peek()/consume().
+template <typename Storage = heap_storage>
+class record_ring_buffer
+{
+public:
+    // Capacity in bytes, rounded up like the spsc_ring_buffer capacity.
+    explicit record_ring_buffer(size_t capacity)
+        : d_ring((capacity + sizeof(word) - 1) / sizeof(word))
+    {}
+
+    // Largest record that can ever fit.
+    size_t max_record_size() const noexcept
+    {
+        return (d_ring.capacity() - 1) * sizeof(word);
+    }
+
+    // Producer only. Returns space for a record of size bytes, or nullptr if
+    // the buffer is full. Throws if the record can never fit.
+    char* reserve(size_t size)
+    {
+        if (size > max_record_size())
+            throw std::length_error("Record is larger than the buffer.");
+
+        const size_t words = 1 + (size + sizeof(word) - 1) / sizeof(word);
+        ring_spans<word> spans = d_ring.reserve(words);
+        if (spans.size() < words)
+            return nullptr;
+
+        if (spans.first.size < words)
+        {
+            // Skip to the beginning of the storage
+            write_header(spans.first.data, skip_marker, spans.first.size);
+            d_ring.commit(spans.first.size);
+
+            spans = d_ring.reserve(words);
+            if (spans.size() < words)
+                return nullptr;
+        }
+
+        write_header(spans.first.data, size, words);
+        d_reserved = words;
+        return reinterpret_cast<char*>(spans.first.data + 1);
+    }
+
+    // Producer only. Publishes the record returned by the last reserve().
+    void commit()
+    {
+        d_ring.commit(d_reserved);
+        d_reserved = 0;
+    }
+
+    // Producer only. Copies the record, returns false if the buffer is full.
+    bool try_push(const void* data, size_t size)
+    {
+        char* dst = reserve(size);
+        if (!dst)
+            return false;
+
+        std::memcpy(dst, data, size);
+        commit();
+        return true;
+    }
+
+    // Consumer only. Returns the oldest record, which stays valid until
+    // consume(), or an empty view if there is none.
+    record_view peek()
+    {
+        for (;;)
+        {
+            ring_spans<word> spans = d_ring.peek(1);
+            if (spans.size() == 0)
+                return {};
+
+            const header h = read_header(spans.first.data);
+            if (h.size == skip_marker)
+            {
+                d_ring.consume(h.words);
+                continue;
+            }
+
+            // The producer wrote the whole record before publishing the header.
+            spans = d_ring.peek(h.words);
+            d_peeked = h.words;
+            return {reinterpret_cast<const char*>(spans.first.data + 1), h.size};
+        }
+    }
+
+    // Consumer only. Releases the record returned by the last peek().
+    void consume()
+    {
+        d_ring.consume(d_peeked);
+        d_peeked = 0;
+    }
+
+    // Consumer only. Calls f(data, size) on the oldest record and releases it.
+    // Returns false if there is none.
+    template <typename F>
+    bool try_pop(F&& f)
+    {
+        const record_view rec = peek();
+        if (!rec)
+            return false;
+
+        f(rec.data, rec.size);
+        consume();
+        return true;
+    }
+
+    // Only a snapshot when called from the other side.
+    bool empty() const noexcept
+    {
+        return d_ring.empty();
+    }
+
+    size_t capacity() const noexcept
+    {
+        return d_ring.capacity() * sizeof(word);
+    }
+
+private:
+    // The unit of storage, records and their headers are aligned to it.
+    struct alignas(8) word
+    {
+        unsigned char bytes[8];
+    };
+
+    struct header
+    {
+        uint32_t size;
+        // Including the header
+        uint32_t words;
+    };
+    static_assert(sizeof(header) <= sizeof(word), "The header must fit in a word");
+
+    static constexpr uint32_t skip_marker = UINT32_MAX;
+
+    static void write_header(word* dst, size_t size, size_t words) noexcept
+    {
+        const header h = {static_cast<uint32_t>(size), static_cast<uint32_t>(words)};
+        std::memcpy(dst, &h, sizeof(h));
+    }
+
+    static header read_header(const word* src) noexcept
+    {
+        header h;
+        std::memcpy(&h, src, sizeof(h));
+        return h;
+    }
+
+    spsc_ring_buffer<word, Storage> d_ring;
+
+    // On separate cache lines, like the indices of the ring
+    alignas(64) size_t              d_reserved = 0; // producer only
+    alignas(64) size_t              d_peeked = 0;   // consumer only
+};
+
+} // namespace si
+
+#endif
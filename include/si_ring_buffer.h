@@ -1,37 +1,95 @@
 #ifndef SI_RING_BUFFER_H
 #define SI_RING_BUFFER_H
 
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstddef>
+#include <cstring>
+#include <new>
+#include <numeric>
+#include <optional>
 #include <stdexcept>
+#include <system_error>
+#include <type_traits>
+#include <utility>
+
+#ifdef __linux__
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
 
 namespace si {
 
+// What ring_buffer::push_back does when the buffer is full.
+// Throws std::runtime_error.
+struct throw_when_full {};
+// Replaces the oldest element, so the buffer keeps the last capacity elements.
+// Never throws unless T does.
+struct overwrite_when_full {};
+// Doubles the capacity.
+struct grow_when_full {};
+
+// Single-threaded ring buffer, see spsc_ring_buffer for a lock-free version.
 // lock-free example https://ferrous-systems.com/blog/lock-free-ring-buffer/
-template<typename T>
+//
+// Elements are constructed in place when pushed and destroyed when popped,
+// or when the buffer is destroyed.
+template<typename T, typename Overflow = throw_when_full>
 class ring_buffer
 {
+    static_assert(std::is_same<Overflow, throw_when_full>::value
+                  || std::is_same<Overflow, overwrite_when_full>::value
+                  || std::is_same<Overflow, grow_when_full>::value,
+                  "Unknown overflow policy");
+
 public:
     ring_buffer(size_t capacity)
         : d_head(0)
         , d_size(0)
         , d_capacity(capacity)
-    {
-        d_data = (T*)malloc(capacity * sizeof(T));
-    }
+        , d_data(allocate(capacity))
+    {}
 
     ~ring_buffer()
     {
-        if (d_data)
-            free(d_data);
+        clear();
+        deallocate(d_data);
     }
 
+    ring_buffer(const ring_buffer&) = delete;
+    ring_buffer& operator= (const ring_buffer&) = delete;
+
     void push_back(const T& val)
     {
-        if (d_size == d_capacity)
-            throw std::runtime_error("Buffer is full");
+        emplace_back(val);
+    }
 
-        size_t tail = (d_head + d_size) % d_capacity;
+    void push_back(T&& val)
+    {
+        emplace_back(std::move(val));
+    }
 
-        *(d_data + tail) = val;
+    template <typename ... Args>
+    void emplace_back(Args&&... args)
+    {
+        if (d_size == d_capacity)
+        {
+            if constexpr (std::is_same<Overflow, throw_when_full>::value)
+                throw std::runtime_error("Buffer is full");
+            else if constexpr (std::is_same<Overflow, overwrite_when_full>::value)
+            {
+                // The oldest element becomes the newest one. Assigning reuses
+                // its resources, e.g. the memory of a std::string.
+                assign(d_data[d_head], std::forward<Args>(args)...);
+                d_head = next(d_head);
+                return;
+            }
+            else
+                grow();
+        }
+
+        new (d_data + next(d_head, d_size)) T(std::forward<Args>(args)...);
         d_size ++;
     }
 
@@ -40,15 +98,15 @@ public:
         if (d_size == 0)
             throw std::runtime_error("Can't pop, buffer is empty");
 
-        T* prev = d_data + d_head;
-        // wrap around
-        d_head++;
-        if (d_head == d_capacity)
-            d_head = 0;
-
-        -- d_size;
+        T res(std::move(d_data[d_head]));
+        pop();
+        return res;
+    }
 
-        return *prev; 
+    void clear() noexcept
+    {
+        while (d_size)
+            pop();
     }
 
     size_t size() const
@@ -56,13 +114,438 @@ public:
         return d_size;
     }
 
+    size_t capacity() const
+    {
+        return d_capacity;
+    }
+
+    bool empty() const
+    {
+        return d_size == 0;
+    }
+
 private:
+    static T* allocate(size_t capacity)
+    {
+        // There would be nothing to overwrite
+        if (std::is_same<Overflow, overwrite_when_full>::value && capacity == 0)
+            throw std::invalid_argument("Capacity must be positive.");
+
+        return static_cast<T*>(::operator new(capacity * sizeof(T), std::align_val_t(alignof(T))));
+    }
+
+    static void deallocate(T* data) noexcept
+    {
+        ::operator delete(data, std::align_val_t(alignof(T)));
+    }
+
+    // Index of the element n after idx, without a modulo.
+    size_t next(size_t idx, size_t n = 1) const noexcept
+    {
+        idx += n;
+        return idx >= d_capacity ? idx - d_capacity : idx;
+    }
+
+    void pop() noexcept
+    {
+        d_data[d_head].~T();
+        d_head = next(d_head);
+        -- d_size;
+    }
+
+    template <typename ... Args>
+    static void assign(T& dst, Args&&... args)
+    {
+        if constexpr (sizeof...(Args) == 1 && (std::is_assignable<T&, Args&&>::value && ...))
+            dst = (std::forward<Args>(args), ...);
+        else
+            dst = T(std::forward<Args>(args)...);
+    }
+
+    // Moves the elements to a buffer twice as big, unwrapping them.
+    // If moving T can throw, they are copied and the buffer is left unchanged on failure.
+    void grow()
+    {
+        const size_t capacity = d_capacity ? 2 * d_capacity : 1;
+        T* data = allocate(capacity);
+        size_t moved = 0;
+        try
+        {
+            for (; moved < d_size; ++ moved)
+                new (data + moved) T(std::move_if_noexcept(d_data[next(d_head, moved)]));
+        }
+        catch (...)
+        {
+            for (size_t i = 0; i < moved; ++ i)
+                data[i].~T();
+            deallocate(data);
+            throw;
+        }
+
+        const size_t size = d_size;
+        clear();
+        deallocate(d_data);
+        d_data = data;
+        d_capacity = capacity;
+        d_head = 0;
+        d_size = size;
+    }
+
     size_t d_head; // first element in buffer
     size_t d_size;
     size_t d_capacity;
     T*     d_data;
 };
 
+// Contiguous range of elements inside a ring buffer.
+template <typename T>
+struct ring_span
+{
+    T*     data = nullptr;
+    size_t size = 0;
+
+    T* begin() const noexcept { return data; }
+    T* end() const noexcept { return data + size; }
+};
+
+// A range of a ring buffer is split in two when it wraps around the end
+// of the storage, second is empty otherwise.
+template <typename T>
+struct ring_spans
+{
+    ring_span<T> first;
+    ring_span<T> second;
+
+    size_t size() const noexcept { return first.size + second.size; }
+};
+
+// Storage policies for spsc_ring_buffer.
+// A policy has a nested buffer<T> that owns the memory for capacity elements,
+// the smallest capacity it supports and whether it is mirrored.
+
+// Plain heap allocation, ranges that wrap around are split in two.
+struct heap_storage
+{
+    static constexpr bool mirrored = false;
+
+    static size_t min_capacity(size_t /*elem_size*/) noexcept
+    {
+        return 1;
+    }
+
+    template <typename T>
+    class buffer
+    {
+    public:
+        explicit buffer(size_t capacity)
+            : d_data(static_cast<T*>(::operator new(capacity * sizeof(T), std::align_val_t(alignof(T)))))
+        {}
+
+        ~buffer()
+        {
+            ::operator delete(d_data, std::align_val_t(alignof(T)));
+        }
+
+        buffer(const buffer&) = delete;
+        buffer& operator= (const buffer&) = delete;
+
+        T* data() const noexcept
+        {
+            return d_data;
+        }
+
+    private:
+        T* d_data;
+    };
+};
+
+#ifdef __linux__
+// Maps the same memfd pages twice, back to back, so that the memory right
+// after the end of the buffer is the beginning of the buffer again.
+// Any range of up to capacity elements is contiguous, even if it wraps around.
+// The size of the buffer must be a multiple of the page size.
+// https://fgiesen.wordpress.com/2012/07/21/the-magic-ring-buffer/
+struct mirrored_storage
+{
+    static constexpr bool mirrored = true;
+
+    // The smallest power of two number of elements that fill whole pages.
+    static size_t min_capacity(size_t elem_size) noexcept
+    {
+        const size_t page_size = sysconf(_SC_PAGESIZE);
+        return page_size / std::gcd(page_size, elem_size);
+    }
+
+    template <typename T>
+    class buffer
+    {
+    public:
+        explicit buffer(size_t capacity)
+            : d_size(capacity * sizeof(T))
+        {
+            const int fd = memfd_create("si_ring_buffer", MFD_CLOEXEC);
+            if (fd == -1)
+                throw std::system_error(errno, std::generic_category(), "memfd_create");
+
+            // Reserve the address range for both copies, then map the pages over it.
+            // errno is saved right after the failing call, before the cleanup
+            // calls can overwrite it.
+            int err = 0;
+            void* addr = MAP_FAILED;
+            if (ftruncate(fd, d_size) != 0)
+                err = errno;
+            else if ((addr = mmap(nullptr, 2 * d_size, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0)) == MAP_FAILED)
+                err = errno;
+            else if (mmap(addr, d_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, 0) == MAP_FAILED
+                     || mmap(static_cast<char*>(addr) + d_size, d_size, PROT_READ | PROT_WRITE,
+                             MAP_SHARED | MAP_FIXED, fd, 0) == MAP_FAILED)
+            {
+                err = errno;
+                munmap(addr, 2 * d_size);
+                addr = MAP_FAILED;
+            }
+
+            close(fd);
+            if (addr == MAP_FAILED)
+                throw std::system_error(err, std::generic_category(), "mmap");
+            d_data = static_cast<T*>(addr);
+        }
+
+        ~buffer()
+        {
+            munmap(d_data, 2 * d_size);
+        }
+
+        buffer(const buffer&) = delete;
+        buffer& operator= (const buffer&) = delete;
+
+        T* data() const noexcept
+        {
+            return d_data;
+        }
+
+    private:
+        size_t d_size;
+        T*     d_data;
+    };
+};
+#endif
+
+// Lock-free ring buffer for a single producer and a single consumer.
+// https://rigtorp.se/ringbuffer/
+//
+// - head and tail only ever grow, the slot is index & mask, so the capacity
+//   is a power of two and all of it can be used (size = tail - head)
+// - only the producer writes the tail and only the consumer writes the head,
+//   so a release store is enough to publish them, no CAS is needed
+// - each side keeps a cached copy of the other side's index and only reloads
+//   it when the buffer looks full (or empty), so in steady state each side
+//   only touches its own cache line
+//
+// For trivially copyable T there is also a zero-copy API that works directly
+// on the storage: the producer fills the spans returned by reserve() and
+// publishes them with commit(), the consumer reads the spans returned by
+// peek() and releases them with consume(). push_range() and pop_range()
+// copy whole ranges with at most two memcpys.
+//
+// With mirrored_storage (Linux only), reserve() and peek() always return a
+// single contiguous span, so parsers can read records that wrap around
+// without copying them first.
+template <typename T, typename Storage = heap_storage>
+class spsc_ring_buffer
+{
+public:
+    // The capacity is rounded up to a power of two, and to the minimum
+    // capacity of the storage.
+    explicit spsc_ring_buffer(size_t capacity)
+        : d_mask(round_up(std::max(capacity, Storage::min_capacity(sizeof(T)))) - 1)
+        , d_buffer(d_mask + 1)
+    {}
+
+    spsc_ring_buffer(const spsc_ring_buffer&) = delete;
+    spsc_ring_buffer& operator= (const spsc_ring_buffer&) = delete;
+
+    ~spsc_ring_buffer()
+    {
+        const size_t tail = d_tail.load(std::memory_order_relaxed);
+        for (size_t head = d_head.load(std::memory_order_relaxed); head != tail; ++ head)
+            slot(head)->~T();
+    }
+
+    // Producer only. Returns false if the buffer is full.
+    bool try_push(const T& val)
+    {
+        return try_emplace(val);
+    }
+
+    bool try_push(T&& val)
+    {
+        return try_emplace(std::move(val));
+    }
+
+    template <typename ... Args>
+    bool try_emplace(Args&&... args)
+    {
+        const size_t tail = d_tail.load(std::memory_order_relaxed);
+        if (tail - d_cached_head > d_mask)
+        {
+            d_cached_head = d_head.load(std::memory_order_acquire);
+            if (tail - d_cached_head > d_mask)
+                return false;
+        }
+
+        new (d_buffer.data() + (tail & d_mask)) T(std::forward<Args>(args)...);
+        d_tail.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer only. Returns false if the buffer is empty.
+    bool try_pop(T& result)
+    {
+        const size_t head = d_head.load(std::memory_order_relaxed);
+        if (head == d_cached_tail)
+        {
+            d_cached_tail = d_tail.load(std::memory_order_acquire);
+            if (head == d_cached_tail)
+                return false;
+        }
+
+        T* val = slot(head);
+        result = std::move(*val);
+        val->~T();
+        d_head.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    std::optional<T> try_pop()
+    {
+        const size_t head = d_head.load(std::memory_order_relaxed);
+        if (head == d_cached_tail)
+        {
+            d_cached_tail = d_tail.load(std::memory_order_acquire);
+            if (head == d_cached_tail)
+                return std::nullopt;
+        }
+
+        T* val = slot(head);
+        std::optional<T> res(std::move(*val));
+        val->~T();
+        d_head.store(head + 1, std::memory_order_release);
+        return res;
+    }
+
+    // Producer only. Returns the free slots after the tail, at most n of them.
+    // They can be written in place, the consumer won't see them until commit().
+    ring_spans<T> reserve(size_t n)
+    {
+        static_assert(std::is_trivially_copyable<T>::value, "T must be trivially copyable");
+        const size_t tail = d_tail.load(std::memory_order_relaxed);
+        if (capacity() - (tail - d_cached_head) < n)
+            d_cached_head = d_head.load(std::memory_order_acquire);
+        return spans(tail, std::min(n, capacity() - (tail - d_cached_head)));
+    }
+
+    // Producer only. Publishes the first n reserved slots.
+    void commit(size_t n)
+    {
+        d_tail.store(d_tail.load(std::memory_order_relaxed) + n, std::memory_order_release);
+    }
+
+    // Consumer only. Returns the elements after the head, at most n of them.
+    // They stay in the buffer until consume().
+    ring_spans<T> peek(size_t n)
+    {
+        static_assert(std::is_trivially_copyable<T>::value, "T must be trivially copyable");
+        const size_t head = d_head.load(std::memory_order_relaxed);
+        if (d_cached_tail - head < n)
+            d_cached_tail = d_tail.load(std::memory_order_acquire);
+        return spans(head, std::min(n, d_cached_tail - head));
+    }
+
+    // Consumer only. Releases the first n peeked elements.
+    void consume(size_t n)
+    {
+        d_head.store(d_head.load(std::memory_order_relaxed) + n, std::memory_order_release);
+    }
+
+    // Producer only. Copies as many elements as fit, returns how many.
+    size_t push_range(const T* src, size_t n)
+    {
+        const ring_spans<T> dst = reserve(n);
+        std::memcpy(dst.first.data, src, dst.first.size * sizeof(T));
+        std::memcpy(dst.second.data, src + dst.first.size, dst.second.size * sizeof(T));
+        commit(dst.size());
+        return dst.size();
+    }
+
+    // Consumer only. Copies up to n elements to dst, returns how many.
+    size_t pop_range(T* dst, size_t n)
+    {
+        const ring_spans<T> src = peek(n);
+        std::memcpy(dst, src.first.data, src.first.size * sizeof(T));
+        std::memcpy(dst + src.first.size, src.second.data, src.second.size * sizeof(T));
+        consume(src.size());
+        return src.size();
+    }
+
+    // Only a snapshot when called from the other side.
+    size_t size() const noexcept
+    {
+        const size_t head = d_head.load(std::memory_order_acquire);
+        return d_tail.load(std::memory_order_acquire) - head;
+    }
+
+    bool empty() const noexcept
+    {
+        return size() == 0;
+    }
+
+    size_t capacity() const noexcept
+    {
+        return d_mask + 1;
+    }
+
+private:
+    // The element constructed at position pos.
+    T* slot(size_t pos) const noexcept
+    {
+        return std::launder(d_buffer.data() + (pos & d_mask));
+    }
+
+    // The n slots from position pos, split at the end of the storage
+    // unless it is mirrored.
+    ring_spans<T> spans(size_t pos, size_t n) const noexcept
+    {
+        T* data = d_buffer.data();
+        const size_t idx = pos & d_mask;
+        if constexpr (Storage::mirrored)
+            return {{data + idx, n}, {data, 0}};
+
+        const size_t first = std::min(n, capacity() - idx);
+        return {{data + idx, first}, {data, n - first}};
+    }
+
+    static size_t round_up(size_t capacity) noexcept
+    {
+        size_t res = 1;
+        while (res < capacity)
+            res <<= 1;
+        return res;
+    }
+
+    // Read-only after construction, shared by both sides.
+    const size_t                         d_mask;
+    typename Storage::template buffer<T> d_buffer;
+
+    // Producer side
+    alignas(64) std::atomic<size_t> d_tail{0};
+    size_t                          d_cached_head = 0;
+
+    // Consumer side
+    alignas(64) std::atomic<size_t> d_head{0};
+    size_t                          d_cached_tail = 0;
+};
+
 } // namespace si
 
 #endif
@@ -0,0 +1,131 @@
+#ifndef SI_SEQLOCK_H
+#define SI_SEQLOCK_H
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <new>
+#include <type_traits>
+
+#include <si_spinlock_mutex.h> // for spin_backoff
+
+namespace si {
+
+// Holds a small value that is read often and written rarely, like a config or
+// the top of an order book. Readers never write to shared memory, so they
+// don't take the cache line away from each other: they copy the value and
+// retry if a writer changed the sequence number meanwhile. Writers never wait
+// for readers, only for each other.
+//
+// The copy is made of relaxed atomic words, so a torn read is a retry rather
+// than a data race.
+template <typename T>
+class seqlock
+{
+    static_assert(std::is_trivially_copyable<T>::value, "seqlock copies T byte by byte");
+
+public:
+    seqlock(const T& val = T{}) noexcept
+    {
+        write_words(val);
+    }
+
+    seqlock(const seqlock&) = delete;
+    seqlock& operator= (const seqlock&) = delete;
+
+    T load() const noexcept
+    {
+        uint64_t words[num_words];
+        spin_backoff backoff;
+        for (;;)
+        {
+            const uint64_t seq = d_seq.load(std::memory_order_acquire);
+            if (seq & 1)
+            {
+                // A writer is in the middle of a store
+                backoff.pause();
+                continue;
+            }
+
+            for (size_t i = 0; i < num_words; ++ i)
+                words[i] = d_words[i].load(std::memory_order_relaxed);
+
+            // Keeps the words above from being read after the check
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (d_seq.load(std::memory_order_relaxed) == seq)
+                break;
+        }
+
+        return from_words(words);
+    }
+
+    void store(const T& val) noexcept
+    {
+        const uint64_t seq = begin_write();
+        write_words(val);
+        d_seq.store(seq + 2, std::memory_order_release);
+    }
+
+    // Changes the value in place with f(T&), atomically with respect to
+    // other writers.
+    template <typename F>
+    void update(F f)
+    {
+        const uint64_t seq = begin_write();
+        uint64_t words[num_words];
+        for (size_t i = 0; i < num_words; ++ i)
+            words[i] = d_words[i].load(std::memory_order_relaxed);
+        T val = from_words(words);
+
+        f(val);
+        write_words(val);
+        d_seq.store(seq + 2, std::memory_order_release);
+    }
+
+private:
+    static constexpr size_t num_words = (sizeof(T) + sizeof(uint64_t) - 1) / sizeof(uint64_t);
+
+    // Makes the sequence number odd, which excludes the other writers.
+    // Returns the even number it started from.
+    uint64_t begin_write() noexcept
+    {
+        uint64_t seq = d_seq.load(std::memory_order_relaxed);
+        spin_backoff backoff;
+        for (;;)
+        {
+            if (!(seq & 1) && d_seq.compare_exchange_weak(seq, seq + 1, std::memory_order_acquire,
+                                                          std::memory_order_relaxed))
+                break;
+            backoff.pause();
+            seq = d_seq.load(std::memory_order_relaxed);
+        }
+
+        // Keeps the words written next from being seen before the odd number
+        std::atomic_thread_fence(std::memory_order_release);
+        return seq;
+    }
+
+    // T need not be default constructible: the bytes are copied into raw
+    // storage, where they make a T since it's trivially copyable.
+    static T from_words(const uint64_t* words) noexcept
+    {
+        alignas(T) unsigned char storage[sizeof(T)];
+        std::memcpy(storage, words, sizeof(T));
+        return *std::launder(reinterpret_cast<T*>(storage));
+    }
+
+    void write_words(const T& val) noexcept
+    {
+        uint64_t words[num_words] = {};
+        std::memcpy(words, &val, sizeof(T));
+        for (size_t i = 0; i < num_words; ++ i)
+            d_words[i].store(words[i], std::memory_order_relaxed);
+    }
+
+    std::atomic<uint64_t> d_seq{0};
+    std::atomic<uint64_t> d_words[num_words];
+};
+
+} // namespace si
+
+#endif
@@ -1,8 +1,13 @@
 #ifndef SI_SPINLOCK_MUTEX_H
 #define SI_SPINLOCK_MUTEX_H
 
+#include <algorithm>
 #include <atomic>
+#include <chrono>
+#include <cstdint>
 #include <immintrin.h> // for _mm_pause
+#include <thread>
+#include <vector>
 
 namespace si {
 
@@ -17,6 +22,11 @@ public:
             ; // busy waiting
     }
 
+    bool try_lock() noexcept
+    {
+        return !d_flag.test_and_set(std::memory_order_acquire);
+    }
+
     void unlock() noexcept
     {
         d_flag.clear(std::memory_order_release);
@@ -45,6 +55,11 @@ struct spinlock_amd
             _mm_pause();
         }
     }
+    bool try_lock()
+    {
+        bool was_locked = locked.load(std::memory_order_relaxed);
+        return !was_locked && locked.compare_exchange_strong(was_locked, true, std::memory_order_acquire);
+    }
     void unlock()
     {
         locked.store(false, std::memory_order_release);
@@ -54,6 +69,342 @@ private:
     std::atomic<bool> locked{false};
 };
 
+// Pauses while spinning, and lets other threads run once it spun for a while.
+// A FIFO lock can only be handed to one particular thread, so when that
+// thread is preempted the others must not burn its time slice.
+class spin_backoff
+{
+public:
+    void pause() noexcept
+    {
+        if (d_count < spin_limit)
+        {
+            ++ d_count;
+            _mm_pause();
+        }
+        else
+            std::this_thread::yield();
+    }
+
+private:
+    static constexpr unsigned spin_limit = 1024;
+    unsigned d_count = 0;
+};
+
+// FIFO spinlock: threads take a ticket and wait until it's served, so the
+// lock is handed over in arrival order and no thread starves.
+// Waiters still all spin on the same cache line, but they only read it, and
+// they back off in proportion to how many threads are ahead of them.
+// Like all FIFO locks it suffers when there are more threads than cores.
+class ticket_lock
+{
+public:
+    void lock() noexcept
+    {
+        const uint32_t ticket = d_next.fetch_add(1, std::memory_order_relaxed);
+        spin_backoff backoff;
+        for (;;)
+        {
+            const uint32_t serving = d_serving.load(std::memory_order_acquire);
+            if (serving == ticket)
+                return;
+
+            for (uint32_t i = ticket - serving; i != 0; -- i)
+                backoff.pause();
+        }
+    }
+
+    bool try_lock() noexcept
+    {
+        uint32_t serving = d_serving.load(std::memory_order_relaxed);
+        // Only succeeds if nobody holds or waits for the lock
+        return d_next.compare_exchange_strong(serving, serving + 1, std::memory_order_acquire,
+                                              std::memory_order_relaxed);
+    }
+
+    void unlock() noexcept
+    {
+        // Only the owner writes it
+        d_serving.store(d_serving.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+private:
+    // Lockers and waiters on separate cache lines
+    alignas(64) std::atomic<uint32_t> d_next{0};
+    alignas(64) std::atomic<uint32_t> d_serving{0};
+};
+
+// MCS queue lock by Mellor-Crummey and Scott.
+// https://www.cs.rochester.edu/u/scott/papers/1991_TOCS_synch.pdf
+//
+// Waiters form a linked list of nodes, each one spins on the flag of its own
+// node and the owner hands the lock over by clearing its successor's flag.
+// So a handoff only touches the cache lines of two threads, no matter how many
+// are waiting, and the lock is FIFO.
+//
+// lock(node&) / unlock(node&) take a node from the caller, usually on its
+// stack, which must stay alive until unlock. lock() / unlock() make it a
+// drop-in Lockable with a node from a per thread cache.
+class mcs_lock
+{
+public:
+    struct alignas(64) node
+    {
+        std::atomic<node*> next{nullptr};
+        std::atomic<bool>  locked{false};
+    };
+
+    void lock(node& n) noexcept
+    {
+        n.next.store(nullptr, std::memory_order_relaxed);
+        n.locked.store(true, std::memory_order_relaxed);
+
+        node* prev = d_tail.exchange(&n, std::memory_order_acq_rel);
+        if (!prev)
+            return;
+
+        // Publishes n to the owner, which clears our flag
+        prev->next.store(&n, std::memory_order_release);
+        spin_backoff backoff;
+        while (n.locked.load(std::memory_order_acquire))
+            backoff.pause();
+    }
+
+    bool try_lock(node& n) noexcept
+    {
+        n.next.store(nullptr, std::memory_order_relaxed);
+        node* expected = nullptr;
+        return d_tail.compare_exchange_strong(expected, &n, std::memory_order_acq_rel,
+                                              std::memory_order_relaxed);
+    }
+
+    void unlock(node& n) noexcept
+    {
+        node* succ = n.next.load(std::memory_order_acquire);
+        if (!succ)
+        {
+            // Nobody is waiting
+            node* expected = &n;
+            if (d_tail.compare_exchange_strong(expected, nullptr, std::memory_order_release,
+                                               std::memory_order_relaxed))
+                return;
+
+            // A thread swapped the tail but didn't link itself yet
+            spin_backoff backoff;
+            while (!(succ = n.next.load(std::memory_order_acquire)))
+                backoff.pause();
+        }
+        succ->locked.store(false, std::memory_order_release);
+    }
+
+    void lock()
+    {
+        node* n = acquire_node();
+        lock(*n);
+        d_owner = n;
+    }
+
+    bool try_lock()
+    {
+        node* n = acquire_node();
+        if (!try_lock(*n))
+        {
+            release_node(n);
+            return false;
+        }
+        d_owner = n;
+        return true;
+    }
+
+    void unlock()
+    {
+        node* n = d_owner;
+        unlock(*n);
+        // Nobody references the node after the handoff
+        release_node(n);
+    }
+
+private:
+    // A thread needs one node per MCS lock it holds at the same time.
+    struct node_cache
+    {
+        ~node_cache()
+        {
+            for (node* n : free)
+                delete n;
+        }
+
+        std::vector<node*> free;
+    };
+
+    static node* acquire_node()
+    {
+        node_cache& cache = t_nodes;
+        if (cache.free.empty())
+            return new node;
+
+        node* n = cache.free.back();
+        cache.free.pop_back();
+        return n;
+    }
+
+    static void release_node(node* n)
+    {
+        t_nodes.free.push_back(n);
+    }
+
+    static inline thread_local node_cache t_nodes;
+
+    std::atomic<node*> d_tail{nullptr};
+    // Only accessed by the owner
+    node*              d_owner = nullptr;
+};
+
+// Spins a little in case the owner is about to unlock, then sleeps on a futex
+// (std::atomic::wait) so that waiters don't take the CPU from the owner when
+// there are more threads than cores.
+// The state tells unlock whether anybody may be sleeping, as in Drepper's
+// "Futexes are tricky", so an uncontended unlock makes no syscall.
+class adaptive_mutex
+{
+public:
+    void lock() noexcept
+    {
+        uint32_t expected = unlocked;
+        if (!d_state.compare_exchange_strong(expected, locked, std::memory_order_acquire,
+                                             std::memory_order_relaxed))
+            lock_contended();
+    }
+
+    bool try_lock() noexcept
+    {
+        uint32_t expected = unlocked;
+        return d_state.compare_exchange_strong(expected, locked, std::memory_order_acquire,
+                                               std::memory_order_relaxed);
+    }
+
+    void unlock() noexcept
+    {
+        if (d_state.exchange(unlocked, std::memory_order_release) == sleepers)
+            d_state.notify_one();
+    }
+
+private:
+    enum : uint32_t { unlocked, locked, sleepers };
+
+    // Number of pauses that take about as long as going to sleep and being
+    // woken up. _mm_pause takes anything from 10 to 150 cycles depending on
+    // the CPU, so it's measured once.
+    static unsigned spin_limit() noexcept
+    {
+        static const unsigned limit = []() {
+            using namespace std::chrono;
+            const unsigned num_pauses = 1000;
+            const auto start = steady_clock::now();
+            for (unsigned i = 0; i < num_pauses; ++ i)
+                _mm_pause();
+            const double ns_per_pause =
+                duration_cast<duration<double, std::nano>>(steady_clock::now() - start).count() / num_pauses;
+            const double sleep_ns = 5000;
+            return static_cast<unsigned>(std::clamp(sleep_ns / std::max(ns_per_pause, 0.1), 64.0, 65536.0));
+        }();
+        return limit;
+    }
+
+    void lock_contended() noexcept
+    {
+        // Exponential backoff, checking the lock with a plain load between the pauses
+        const unsigned limit = spin_limit();
+        for (unsigned spun = 0, delay = 1; spun < limit; spun += delay, delay = std::min(delay * 2, 64u))
+        {
+            for (unsigned i = 0; i < delay; ++ i)
+                _mm_pause();
+
+            uint32_t state = d_state.load(std::memory_order_relaxed);
+            if (state == unlocked && d_state.compare_exchange_weak(state, locked, std::memory_order_acquire,
+                                                                   std::memory_order_relaxed))
+                return;
+        }
+
+        // Once a thread slept, the lock is taken as sleepers: it can't tell
+        // whether others are still asleep, so the next unlock must wake one up.
+        while (d_state.exchange(sleepers, std::memory_order_acquire) != unlocked)
+            d_state.wait(sleepers, std::memory_order_relaxed);
+    }
+
+    std::atomic<uint32_t> d_state{unlocked};
+};
+
+// Reader-writer spinlock for very short critical sections, a SharedMutex
+// that fits in one word: the readers count and the writer bits share it.
+// Writers have preference: a waiting writer sets a bit that keeps new readers
+// out, so a steady stream of readers can't starve it.
+class rw_spinlock
+{
+public:
+    void lock() noexcept
+    {
+        spin_backoff backoff;
+        for (;;)
+        {
+            uint32_t state = d_state.load(std::memory_order_relaxed);
+            // Free apart from maybe other waiting writers. Taking it clears
+            // the waiting bit, the writers still waiting set it again.
+            if ((state & ~writer_waiting) == 0)
+            {
+                if (d_state.compare_exchange_weak(state, writer, std::memory_order_acquire,
+                                                  std::memory_order_relaxed))
+                    return;
+            }
+            else if (!(state & writer_waiting))
+                d_state.fetch_or(writer_waiting, std::memory_order_relaxed);
+            backoff.pause();
+        }
+    }
+
+    bool try_lock() noexcept
+    {
+        uint32_t state = d_state.load(std::memory_order_relaxed);
+        return (state & ~writer_waiting) == 0
+            && d_state.compare_exchange_strong(state, writer, std::memory_order_acquire,
+                                               std::memory_order_relaxed);
+    }
+
+    void unlock() noexcept
+    {
+        // Keeps the bit of a waiting writer
+        d_state.fetch_and(~writer, std::memory_order_release);
+    }
+
+    void lock_shared() noexcept
+    {
+        spin_backoff backoff;
+        while (!try_lock_shared())
+            backoff.pause();
+    }
+
+    bool try_lock_shared() noexcept
+    {
+        uint32_t state = d_state.load(std::memory_order_relaxed);
+        return !(state & (writer | writer_waiting))
+            && d_state.compare_exchange_weak(state, state + reader, std::memory_order_acquire,
+                                             std::memory_order_relaxed);
+    }
+
+    void unlock_shared() noexcept
+    {
+        d_state.fetch_sub(reader, std::memory_order_release);
+    }
+
+private:
+    static constexpr uint32_t writer         = 1;
+    static constexpr uint32_t writer_waiting = 2;
+    // The readers count starts at bit 2
+    static constexpr uint32_t reader         = 4;
+
+    std::atomic<uint32_t> d_state{0};
+};
+
 } // namespace si
 
 #endif
@@ -1,46 +1,415 @@
 #ifndef SI_SPMC_QUEUE_H
 #define SI_SPMC_QUEUE_H
 
+#include <si_coroutine.h>
+#include <si_futex_condition.h>
+
+#include <atomic>
+#include <chrono>
 #include <condition_variable>
+#include <cstdint>
+#include <immintrin.h> // for _mm_pause
+#include <limits>
+#include <memory>
 #include <mutex>
+#include <new>
+#include <optional>
 #include <queue>
+#include <stdexcept>
+#include <thread>
+#include <type_traits>
+#include <utility>
 
 namespace si {
 
 // Single-producer multiple-consumer queue.
-template <typename T>
+// Unbounded by default. With a capacity, push blocks while the queue is full.
+// After close(), consumers drain the remaining elements and then pop throws.
+// Coroutines wait with co_await q.async_pop(executor) instead of blocking a thread.
+// Lock and Condition can be swapped like in threadsafe_queue.
+template <typename T, typename Lock = std::mutex, typename Condition = default_condition<Lock>>
 class spmc_fifo_queue
 {
 public:
+    spmc_fifo_queue()
+    {}
+
+    explicit spmc_fifo_queue(size_t capacity)
+        : d_capacity(capacity)
+    {
+        if (capacity == 0)
+            throw std::invalid_argument("Capacity must be positive.");
+    }
+
     template <typename ... Args>
     void push(Args&&... args)
     {
-        std::unique_lock<std::mutex> lock_(d_mutex);
+        std::unique_lock<Lock> lock_(d_mutex);
+        d_not_full.wait(lock_, [this](){ return d_queue.size() < d_capacity || d_closed; });
+        if (d_closed)
+            throw std::runtime_error("Queue is closed.");
+
+        if (pop_waiter<T>* w = hand_off(std::forward<Args>(args)...))
+        {
+            lock_.unlock();
+            w->wake();
+            return;
+        }
+
         d_queue.emplace(std::forward<Args>(args)...);
         lock_.unlock();
 
         d_cond.notify_one();
     }
 
+    // Returns false if the queue is full or closed.
+    template <typename ... Args>
+    bool try_push(Args&&... args)
+    {
+        std::unique_lock<Lock> lock_(d_mutex);
+        if (d_closed || d_queue.size() >= d_capacity)
+            return false;
+
+        if (pop_waiter<T>* w = hand_off(std::forward<Args>(args)...))
+        {
+            lock_.unlock();
+            w->wake();
+            return true;
+        }
+
+        d_queue.emplace(std::forward<Args>(args)...);
+        lock_.unlock();
+
+        d_cond.notify_one();
+        return true;
+    }
+
+    // Throws if the queue was closed and there are no elements left.
     T pop()
     {
-        std::unique_lock<std::mutex> lock_(d_mutex);
-        d_cond.wait(lock_, [this](){ return !d_queue.empty(); });
+        std::unique_lock<Lock> lock_(d_mutex);
+        d_cond.wait(lock_, [this](){ return !d_queue.empty() || d_closed; });
+        if (d_queue.empty())
+            throw std::runtime_error("Queue is closed.");
+
+        return pop_front(lock_);
+    }
+
+    // Returns nullopt on timeout, or if the queue was closed and there are no elements left.
+    template <typename Rep, typename Period>
+    std::optional<T> pop_for(const std::chrono::duration<Rep, Period>& timeout)
+    {
+        std::unique_lock<Lock> lock_(d_mutex);
+        if (!d_cond.wait_for(lock_, timeout, [this](){ return !d_queue.empty() || d_closed; })
+            || d_queue.empty())
+            return std::nullopt;
+
+        return pop_front(lock_);
+    }
+
+    // Coroutine version of pop, resumes on ex. co_await returns nullopt
+    // instead of throwing if the queue was closed and there are no elements left.
+    template <typename Executor>
+    pop_awaiter<spmc_fifo_queue, T, Executor> async_pop(Executor& ex)
+    {
+        return {*this, ex};
+    }
+
+    // Wakes up the producer and all the waiting consumers.
+    void close()
+    {
+        std::unique_lock<Lock> lock_(d_mutex);
+        d_closed = true;
+        pop_waiter_list<T> waiters = std::exchange(d_waiters, {});
+        lock_.unlock();
+
+        d_cond.notify_all();
+        d_not_full.notify_all();
+        waiters.wake_all();
+    }
+
+private:
+    template <typename, typename, typename>
+    friend class pop_awaiter;
+
+    // Gives the element to the oldest suspended coroutine, if there is one.
+    template <typename ... Args>
+    pop_waiter<T>* hand_off(Args&&... args)
+    {
+        if (d_waiters.empty())
+            return nullptr;
 
+        pop_waiter<T>* w = d_waiters.front();
+        w->value.emplace(std::forward<Args>(args)...);
+        d_waiters.pop_front();
+        return w;
+    }
+
+    // Returns false if the coroutine doesn't need to suspend.
+    bool suspend_pop(pop_waiter<T>& w)
+    {
+        std::unique_lock<Lock> lock_(d_mutex);
+        if (!d_queue.empty())
+        {
+            w.value.emplace(pop_front(lock_));
+            return false;
+        }
+        if (d_closed)
+            return false;
+
+        d_waiters.push_back(&w);
+        return true;
+    }
+
+    T pop_front(std::unique_lock<Lock>& lock_)
+    {
         T elem = std::move(d_queue.front());
         d_queue.pop();
+        lock_.unlock();
 
+        if (d_capacity != std::numeric_limits<size_t>::max())
+            d_not_full.notify_one();
         return elem;
     }
 
-private:
     // DATA
-    std::queue<T>           d_queue;
-    std::mutex              d_mutex;
-    std::condition_variable d_cond;
+    std::queue<T>      d_queue;
+    size_t             d_capacity = std::numeric_limits<size_t>::max();
+    bool               d_closed = false;
+    Lock               d_mutex;
+    Condition          d_cond;
+    Condition          d_not_full;
+    pop_waiter_list<T> d_waiters;
+};
+
+// Lock-free bounded single-producer multiple-consumer queue with the same
+// interface as spmc_fifo_queue.
+//
+// Each cell has a sequence number like in mpmc_queue: seq == pos when the
+// producer can write the cell at position pos, seq == pos + 1 when a consumer
+// can read it. The producer owns the tail, so it publishes with a plain store.
+// Consumers claim cells with a CAS on the head.
+//
+// Idle consumers spin for a short while and then park on a futex through
+// std::atomic::wait. The producer only makes the wake up syscall when a
+// consumer is parked, so pushing into a busy queue never enters the kernel.
+// A full queue makes the producer spin and yield instead, which keeps the
+// consumers' pop free of any fence.
+//
+// T must be nothrow move constructible, a claimed cell can't be given back.
+template <typename T>
+class lockfree_spmc_queue
+{
+    static_assert(std::is_nothrow_move_constructible<T>::value,
+                  "T must be nothrow move constructible");
+
+public:
+    // The capacity is rounded up to a power of two.
+    explicit lockfree_spmc_queue(size_t capacity)
+        : d_mask(round_up(capacity) - 1)
+        , d_cells(new cell[d_mask + 1])
+    {
+        if (capacity == 0)
+            throw std::invalid_argument("Capacity must be positive.");
+
+        for (size_t i = 0; i <= d_mask; ++ i)
+            d_cells[i].seq.store(i, std::memory_order_relaxed);
+    }
+
+    lockfree_spmc_queue(const lockfree_spmc_queue&) = delete;
+    lockfree_spmc_queue& operator= (const lockfree_spmc_queue&) = delete;
+
+    // Assumes no other thread is using the queue anymore.
+    ~lockfree_spmc_queue()
+    {
+        for (size_t pos = d_head.load(std::memory_order_relaxed); pos != d_tail; ++ pos)
+            d_cells[pos & d_mask].value()->~T();
+    }
+
+    // Producer only. Blocks while the queue is full, throws if it was closed.
+    template <typename ... Args>
+    void push(Args&&... args)
+    {
+        for (unsigned i = 0; ; ++ i)
+        {
+            if (d_closed.load(std::memory_order_relaxed))
+                throw std::runtime_error("Queue is closed.");
+            if (can_push())
+                break;
+            if (i < spin_count)
+                _mm_pause();
+            else
+                std::this_thread::yield();
+        }
+
+        emplace(std::forward<Args>(args)...);
+    }
+
+    // Producer only. Returns false if the queue is full or closed.
+    template <typename ... Args>
+    bool try_push(Args&&... args)
+    {
+        if (!can_push() || d_closed.load(std::memory_order_relaxed))
+            return false;
+
+        emplace(std::forward<Args>(args)...);
+        return true;
+    }
+
+    // Returns false if the queue is empty.
+    bool try_pop(T& result)
+    {
+        return try_take([&result](T& val) { result = std::move(val); });
+    }
+
+    // Throws if the queue was closed and there are no elements left.
+    T pop()
+    {
+        std::optional<T> result;
+        if (!wait_and_take([&result](T& val) { result.emplace(std::move(val)); }))
+            throw std::runtime_error("Queue is closed.");
+        return std::move(*result);
+    }
+
+    // Wakes up the producer and all the parked consumers.
+    void close()
+    {
+        d_closed.store(true, std::memory_order_release);
+        d_epoch.fetch_add(1, std::memory_order_seq_cst);
+        d_epoch.notify_all();
+    }
+
+    // Only a snapshot when called by a consumer.
+    bool empty() const noexcept
+    {
+        const size_t head = d_head.load(std::memory_order_acquire);
+        return d_cells[head & d_mask].seq.load(std::memory_order_acquire) != head + 1;
+    }
+
+    size_t capacity() const noexcept
+    {
+        return d_mask + 1;
+    }
+
+private:
+    struct cell
+    {
+        std::atomic<size_t> seq;
+        alignas(T) unsigned char storage[sizeof(T)];
+
+        T* value() noexcept
+        {
+            return std::launder(reinterpret_cast<T*>(&storage));
+        }
+    };
+
+    static constexpr unsigned spin_count = 64;
+    static constexpr unsigned yield_count = 16;
+
+    static size_t round_up(size_t capacity) noexcept
+    {
+        size_t res = 1;
+        while (res < capacity)
+            res <<= 1;
+        return res;
+    }
+
+    bool can_push() const noexcept
+    {
+        return d_cells[d_tail & d_mask].seq.load(std::memory_order_acquire) == d_tail;
+    }
+
+    template <typename ... Args>
+    void emplace(Args&&... args)
+    {
+        cell& c = d_cells[d_tail & d_mask];
+        new (&c.storage) T(std::forward<Args>(args)...);
+        c.seq.store(d_tail + 1, std::memory_order_release);
+        ++ d_tail;
+
+        // Pairs with the fence in wait_and_take(): either the consumer sees
+        // the new element before parking, or we see it parked.
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (d_parked.load(std::memory_order_relaxed) == 0)
+            return;
+
+        d_epoch.fetch_add(1, std::memory_order_seq_cst);
+        d_epoch.notify_one();
+    }
+
+    // Claims the oldest element and calls f(T&) on it.
+    // Returns false if the queue is empty.
+    template <typename F>
+    bool try_take(F f)
+    {
+        size_t pos = d_head.load(std::memory_order_relaxed);
+        for (;;)
+        {
+            cell& c = d_cells[pos & d_mask];
+            const size_t seq = c.seq.load(std::memory_order_acquire);
+            const intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos + 1);
+            if (diff < 0)
+                return false;
+            if (diff > 0)
+                pos = d_head.load(std::memory_order_relaxed);
+            else if (d_head.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+            {
+                f(*c.value());
+                c.value()->~T();
+                // Hand the cell over to the producer one lap ahead
+                c.seq.store(pos + d_mask + 1, std::memory_order_release);
+                return true;
+            }
+        }
+    }
+
+    // Returns false if the queue was closed and there are no elements left.
+    template <typename F>
+    bool wait_and_take(F f)
+    {
+        for (unsigned i = 0; i < spin_count + yield_count; ++ i)
+        {
+            if (try_take(f))
+                return true;
+            if (i < spin_count)
+                _mm_pause();
+            else
+                std::this_thread::yield();
+        }
+
+        for (;;)
+        {
+            d_parked.fetch_add(1, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            // Any push or close after this load changes the epoch,
+            // so wait() returns right away.
+            const uint32_t epoch = d_epoch.load(std::memory_order_acquire);
+            const bool taken = try_take(f);
+            const bool closed = !taken && d_closed.load(std::memory_order_acquire);
+            if (!taken && !closed)
+                d_epoch.wait(epoch, std::memory_order_acquire);
+            d_parked.fetch_sub(1, std::memory_order_relaxed);
+
+            if (taken || try_take(f))
+                return true;
+            if (closed)
+                return false;
+        }
+    }
+
+    // Read-only after construction, shared by everyone.
+    const size_t            d_mask;
+    std::unique_ptr<cell[]> d_cells;
+
+    alignas(64) size_t                d_tail = 0; // producer only
+    alignas(64) std::atomic<size_t>   d_head{0};
+
+    // Futex word of the parked consumers and how many there are.
+    alignas(64) std::atomic<uint32_t> d_epoch{0};
+    std::atomic<uint32_t>             d_parked{0};
+    std::atomic<bool>                 d_closed{false};
 };
 
 } // namespace si
 
 #endif
-
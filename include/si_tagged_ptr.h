@@ -0,0 +1,74 @@
+#ifndef SI_TAGGED_PTR_H
+#define SI_TAGGED_PTR_H
+
+#include <cstdint>
+
+namespace si {
+
+// Pointer packed with a 16-bit version counter in the unused upper bits.
+// x86-64 and AArch64 only use the lower 48 bits for user space addresses,
+// so a tagged_ptr still fits into a single word and std::atomic<tagged_ptr>
+// can use a regular 64-bit CAS (no need for cmpxchg16b).
+//
+// Lock-free structures bump the tag every time they change the pointer.
+// A CAS on a tagged_ptr then fails if the pointer was changed and changed
+// back in the meantime (ABA), unless this happened exactly 65536 times.
+template <typename T>
+class tagged_ptr
+{
+    static_assert(sizeof(void*) == 8, "tagged_ptr needs 64-bit pointers");
+
+public:
+    tagged_ptr() noexcept = default;
+
+    tagged_ptr(T* ptr, uint16_t tag = 0) noexcept
+        : d_value(reinterpret_cast<uint64_t>(ptr) | (uint64_t(tag) << tag_shift))
+    {}
+
+    T* get() const noexcept
+    {
+        return reinterpret_cast<T*>(d_value & pointer_mask);
+    }
+
+    uint16_t tag() const noexcept
+    {
+        return static_cast<uint16_t>(d_value >> tag_shift);
+    }
+
+    T* operator-> () const noexcept
+    {
+        return get();
+    }
+
+    explicit operator bool() const noexcept
+    {
+        return get() != nullptr;
+    }
+
+    bool operator== (const tagged_ptr& other) const noexcept
+    {
+        return d_value == other.d_value;
+    }
+
+    bool operator!= (const tagged_ptr& other) const noexcept
+    {
+        return d_value != other.d_value;
+    }
+
+private:
+    static constexpr unsigned tag_shift    = 48;
+    static constexpr uint64_t pointer_mask = (uint64_t(1) << tag_shift) - 1;
+
+    uint64_t d_value = 0;
+};
+
+// Lets the reclamation schemes protect the pointer part of a tagged_ptr.
+template <typename T>
+T* raw_pointer(tagged_ptr<T> ptr) noexcept
+{
+    return ptr.get();
+}
+
+} // namespace si
+
+#endif
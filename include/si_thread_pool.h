@@ -0,0 +1,286 @@
+#ifndef SI_THREAD_POOL_H
+#define SI_THREAD_POOL_H
+
+#include <si_function.h>
+#include <si_two_lock_queue.h>
+#include <si_work_stealing_deque.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <future>
+#include <limits>
+#include <memory>
+#include <optional>
+#include <stdexcept>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace si {
+
+// Work-stealing thread pool.
+//
+// Each worker has a work_stealing_deque of tasks. Tasks scheduled from a
+// worker go to the bottom of its own deque, tasks scheduled from any other
+// thread go to a global injection queue. A worker looks for work in its own
+// deque first, then in the global queue, then steals from the top of the
+// other workers' deques, so recursive work spreads from the oldest (biggest)
+// tasks while every worker keeps running its newest ones.
+//
+// Idle workers park on a futex through std::atomic::wait. Scheduling a task
+// only makes the wake up syscall when a worker is parked.
+//
+// The destructor runs the tasks that were already scheduled and joins the workers.
+class thread_pool
+{
+public:
+    using task = function<void()>;
+
+    explicit thread_pool(unsigned num_threads = std::max(1u, std::thread::hardware_concurrency()))
+    {
+        if (num_threads == 0)
+            throw std::invalid_argument("There must be at least one thread.");
+
+        // All the deques exist before any worker starts stealing.
+        for (unsigned i = 0; i < num_threads; ++ i)
+            d_workers.push_back(std::make_unique<worker>());
+        for (unsigned i = 0; i < num_threads; ++ i)
+            d_workers[i]->thread = std::thread(&thread_pool::worker_loop, this, i);
+    }
+
+    thread_pool(const thread_pool&) = delete;
+    thread_pool& operator= (const thread_pool&) = delete;
+
+    ~thread_pool()
+    {
+        d_stop.store(true, std::memory_order_release);
+        d_epoch.fetch_add(1, std::memory_order_release);
+        d_epoch.notify_all();
+        for (auto& w : d_workers)
+            w->thread.join();
+
+        // Scheduled after the workers were gone
+        task* t;
+        while (d_global.try_pop(t))
+            delete t;
+    }
+
+    // Runs f() on the pool. An exception escaping f terminates the program,
+    // use submit to get it through the future instead.
+    template <typename F>
+    void post(F&& f)
+    {
+        schedule(new task(std::forward<F>(f)));
+    }
+
+    // Runs f() on the pool and returns a future for its result.
+    // Waiting for the future from a worker blocks that worker.
+    template <typename F>
+    std::future<std::invoke_result_t<std::decay_t<F>&>> submit(F&& f)
+    {
+        using result_type = std::invoke_result_t<std::decay_t<F>&>;
+        // packaged_task is move-only, but function needs a copyable target.
+        auto pt = std::make_shared<std::packaged_task<result_type()>>(std::forward<F>(f));
+        std::future<result_type> res = pt->get_future();
+        post([pt]() { (*pt)(); });
+        return res;
+    }
+
+    // Calls body(i) for every i in [begin, end) and returns when all the
+    // calls are done. The range is split in halves down to grain indices
+    // (by default enough chunks for 8 per worker), and the halves are
+    // scheduled so idle workers can steal them. The calling thread runs
+    // tasks while it waits. Rethrows the first exception thrown by body,
+    // the indices that were not started yet are skipped.
+    template <typename F>
+    void parallel_for(size_t begin, size_t end, F body, size_t grain = 0)
+    {
+        if (begin >= end)
+            return;
+        if (grain == 0)
+            grain = std::max<size_t>(1, (end - begin) / (8 * d_workers.size()));
+
+        range_state<F> state{body, grain, end - begin};
+        run_range(&state, begin, end);
+
+        const unsigned self = current_worker();
+        task* t;
+        while (state.remaining.load(std::memory_order_acquire) != 0)
+        {
+            if (find_task(t, self))
+                run(t);
+            else
+                std::this_thread::yield();
+        }
+
+        if (state.error)
+            std::rethrow_exception(state.error);
+    }
+
+    unsigned size() const noexcept
+    {
+        return static_cast<unsigned>(d_workers.size());
+    }
+
+private:
+    static constexpr unsigned no_worker = std::numeric_limits<unsigned>::max();
+    static constexpr unsigned spin_count = 16;
+
+    struct worker
+    {
+        work_stealing_deque<task*> deque;
+        std::thread                thread;
+    };
+
+    template <typename F>
+    struct range_state
+    {
+        F&                  body;
+        const size_t        grain;
+        std::atomic<size_t> remaining;
+        std::atomic<bool>   failed{false};
+        std::exception_ptr  error;
+    };
+
+    // Schedules the upper halves of [begin, end) and runs what's left.
+    template <typename F>
+    void run_range(range_state<F>* state, size_t begin, size_t end)
+    {
+        while (end - begin > state->grain)
+        {
+            const size_t mid = begin + (end - begin) / 2;
+            post([this, state, mid, end]() { run_range(state, mid, end); });
+            end = mid;
+        }
+
+        try
+        {
+            if (!state->failed.load(std::memory_order_relaxed))
+                for (size_t i = begin; i != end; ++ i)
+                    state->body(i);
+        }
+        catch (...)
+        {
+            if (!state->failed.exchange(true))
+                state->error = std::current_exception();
+        }
+        state->remaining.fetch_sub(end - begin, std::memory_order_acq_rel);
+    }
+
+    // The index of the calling thread in this pool, or no_worker.
+    unsigned current_worker() const noexcept
+    {
+        return t_pool == this ? t_index : no_worker;
+    }
+
+    void schedule(task* t)
+    {
+        const unsigned self = current_worker();
+        if (self != no_worker)
+            d_workers[self]->deque.push(t);
+        else
+            d_global.push(t);
+
+        // Pairs with the fence in worker_loop(): either the worker finds the
+        // task before parking, or we see it parked.
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (d_sleepers.load(std::memory_order_relaxed) == 0)
+            return;
+
+        d_epoch.fetch_add(1, std::memory_order_release);
+        d_epoch.notify_one();
+    }
+
+    // Own deque first, then the global queue, then the other deques.
+    bool find_task(task*& t, unsigned self)
+    {
+        if (self != no_worker)
+            if (std::optional<task*> own = d_workers[self]->deque.pop())
+            {
+                t = *own;
+                return true;
+            }
+
+        if (d_global.try_pop(t))
+            return true;
+
+        // Start from a different victim every time
+        const unsigned n = size();
+        const unsigned start = t_victim++;
+        for (unsigned i = 0; i < n; ++ i)
+        {
+            const unsigned victim = (start + i) % n;
+            if (victim == self)
+                continue;
+            if (std::optional<task*> stolen = d_workers[victim]->deque.steal())
+            {
+                t = *stolen;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    static void run(task* t)
+    {
+        std::unique_ptr<task> owner(t);
+        (*t)();
+    }
+
+    void worker_loop(unsigned index)
+    {
+        t_pool = this;
+        t_index = index;
+
+        task* t;
+        for (;;)
+        {
+            bool found = find_task(t, index);
+            for (unsigned i = 0; !found && i < spin_count; ++ i)
+            {
+                std::this_thread::yield();
+                found = find_task(t, index);
+            }
+
+            if (!found)
+            {
+                d_sleepers.fetch_add(1, std::memory_order_relaxed);
+                std::atomic_thread_fence(std::memory_order_seq_cst);
+                // Any task scheduled after this load changes the epoch,
+                // so wait() returns right away.
+                const uint32_t epoch = d_epoch.load(std::memory_order_acquire);
+                found = find_task(t, index);
+                const bool stop = !found && d_stop.load(std::memory_order_acquire);
+                if (!found && !stop)
+                    d_epoch.wait(epoch, std::memory_order_acquire);
+                d_sleepers.fetch_sub(1, std::memory_order_relaxed);
+
+                if (stop)
+                    return;
+            }
+
+            if (found)
+                run(t);
+        }
+    }
+
+    std::vector<std::unique_ptr<worker>> d_workers;
+    two_lock_queue<task*>                d_global;
+
+    // Futex word of the parked workers and how many there are.
+    alignas(64) std::atomic<uint32_t>    d_epoch{0};
+    std::atomic<uint32_t>                d_sleepers{0};
+    std::atomic<bool>                    d_stop{false};
+
+    static inline thread_local const thread_pool* t_pool = nullptr;
+    static inline thread_local unsigned           t_index = 0;
+    static inline thread_local unsigned           t_victim = 0;
+};
+
+} // namespace si
+
+#endif
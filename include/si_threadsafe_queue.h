@@ -1,92 +1,376 @@
 #ifndef SI_THREADSAFE_QUEUE_H
 #define SI_THREADSAFE_QUEUE_H
 
+#include <si_coroutine.h>
+#include <si_futex_condition.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <limits>
 #include <memory>
 #include <mutex>
 #include <queue>
+#include <stdexcept>
 #include <thread>
+#include <utility>
+#include <vector>
 
 namespace si {
 
 
-template <class T>
+// Unbounded by default. When constructed with a capacity, push blocks while
+// the queue is full (backpressure) and try_push fails instead.
+//
+// close() wakes up all the waiting threads. Pushing to a closed queue throws
+// (or fails for try_push), while consumers can still pop the remaining
+// elements, after which the pops return false / nullptr.
+//
+// Coroutines wait with co_await q.async_pop(executor) instead of blocking a
+// thread. A push hands the element straight to the oldest suspended coroutine
+// and resumes it on its executor.
+//
+// Lock is any Lockable, e.g. si::spinlock_amd or si::profiled_lock<std::mutex>,
+// and Condition what waits with it: std::condition_variable for std::mutex,
+// std::condition_variable_any or si::futex_condition for anything.
+template <class T, class Lock = std::mutex, class Condition = default_condition<Lock>>
 class threadsafe_queue
 {
 public:
     threadsafe_queue()
     {}
 
-    threadsafe_queue(const threadsafe_queue<T>& other)
+    explicit threadsafe_queue(size_t capacity)
+        : d_capacity(capacity)
+    {
+        if (capacity == 0)
+            throw std::invalid_argument("Capacity must be positive.");
+    }
+
+    threadsafe_queue(const threadsafe_queue& other)
     {
-        std::lock_guard<std::mutex> guard(other.d_mutex);
+        std::lock_guard<Lock> guard(other.d_mutex);
         d_queue = other.d_queue;
+        d_capacity = other.d_capacity;
+        d_closed = other.d_closed;
     }
 
-    threadsafe_queue& operator= (const threadsafe_queue<T>& other) = delete;
+    threadsafe_queue& operator= (const threadsafe_queue& other) = delete;
 
     void push(const T& val)
     {
-        std::unique_lock<std::mutex> ulock(d_mutex);
-        d_queue.push(val);
+        emplace(val);
+    }
+
+    void push(T&& val)
+    {
+        emplace(std::move(val));
+    }
+
+    template <typename ... Args>
+    void emplace(Args&&... args)
+    {
+        std::unique_lock<Lock> ulock(d_mutex);
+        wait_not_full(ulock);
+        if (d_closed)
+            throw std::runtime_error("Queue is closed.");
+
+        if (pop_waiter<T>* w = hand_off(std::forward<Args>(args)...))
+        {
+            ulock.unlock();
+            w->wake();
+            return;
+        }
+
+        d_queue.emplace(std::forward<Args>(args)...);
         ulock.unlock();
 
         d_cond.notify_one();
     }
 
-    void wait_and_pop(T& result)
+    // Returns false if the queue is full or closed.
+    bool try_push(const T& val)
     {
-        std::unique_lock<std::mutex> ulock(d_mutex);
-        d_cond.wait(ulock, [this](){ return !empty(); });
+        return try_emplace(val);
+    }
 
-        result = d_queue.front();
-        d_queue.pop();
+    bool try_push(T&& val)
+    {
+        return try_emplace(std::move(val));
     }
 
+    // Pushes all the elements with a single lock acquisition and a single notify,
+    // unless the queue is bounded and has to be drained in between.
+    template <typename InputIt>
+    void push_bulk(InputIt first, InputIt last)
+    {
+        pop_waiter_list<T> woken;
+        size_t queued = 0;
+        std::unique_lock<Lock> ulock(d_mutex);
+        for (; first != last; ++ first)
+        {
+            if (bounded() && d_queue.size() >= d_capacity && !d_closed)
+            {
+                // The woken coroutines may be the consumers that make room
+                notify_pushed(ulock, woken, queued);
+                ulock.lock();
+                wait_not_full(ulock);
+            }
+            if (d_closed)
+            {
+                notify_pushed(ulock, woken, queued);
+                throw std::runtime_error("Queue is closed.");
+            }
+
+            // Coroutines that suspended while the lock was released come first
+            if (pop_waiter<T>* w = hand_off(*first))
+                woken.push_back(w);
+            else
+            {
+                d_queue.push(*first);
+                ++ queued;
+            }
+        }
+        notify_pushed(ulock, woken, queued);
+    }
+
+    // Returns false if the queue was closed and there are no elements left.
+    bool wait_and_pop(T& result)
+    {
+        std::unique_lock<Lock> ulock(d_mutex);
+        d_cond.wait(ulock, [this](){ return !empty() || d_closed; });
+        if (empty())
+            return false;
+
+        result = std::move(d_queue.front());
+        pop_front(ulock);
+        return true;
+    }
+
+    // Returns nullptr if the queue was closed and there are no elements left.
     std::shared_ptr<T> wait_and_pop()
     {
-        std::unique_lock<std::mutex> ulock(d_mutex);
-        d_cond.wait(ulock, [this](){ return !empty(); });
+        std::unique_lock<Lock> ulock(d_mutex);
+        d_cond.wait(ulock, [this](){ return !empty() || d_closed; });
+        if (empty())
+            return nullptr;
 
-        auto ret = std::make_shared<T>(d_queue.front());
-        d_queue.pop();
+        auto ret = std::make_shared<T>(std::move(d_queue.front()));
+        pop_front(ulock);
         return ret;
     }
 
+    // Returns false on timeout, or if the queue was closed and there are no elements left.
+    template <typename Rep, typename Period>
+    bool wait_and_pop_for(T& result, const std::chrono::duration<Rep, Period>& timeout)
+    {
+        std::unique_lock<Lock> ulock(d_mutex);
+        if (!d_cond.wait_for(ulock, timeout, [this](){ return !empty() || d_closed; }) || empty())
+            return false;
+
+        result = std::move(d_queue.front());
+        pop_front(ulock);
+        return true;
+    }
+
     bool try_pop(T& result)
     {
-        std::lock_guard<std::mutex> guard(d_mutex);
+        std::unique_lock<Lock> ulock(d_mutex);
         if (empty())
             return false;
 
-        result = d_queue.front();
-        d_queue.pop();
+        result = std::move(d_queue.front());
+        pop_front(ulock);
         return true;
     }
 
     std::shared_ptr<T> try_pop()
     {
-        std::lock_guard<std::mutex> guard(d_mutex);
+        std::unique_lock<Lock> ulock(d_mutex);
         if (empty())
             return nullptr;
 
-        auto ret = std::make_shared<T>(d_queue.front());
-        d_queue.pop();
+        auto ret = std::make_shared<T>(std::move(d_queue.front()));
+        pop_front(ulock);
         return ret;
     }
 
+    // Moves all the elements to the back of result with a single lock acquisition.
+    // Returns the number of elements that were popped.
+    size_t pop_all(std::vector<T>& result)
+    {
+        std::unique_lock<Lock> ulock(d_mutex);
+        return drain(result, ulock);
+    }
+
+    // Same as pop_all, but waits until there is at least one element.
+    // Returns 0 if the queue was closed and there are no elements left.
+    size_t wait_and_pop_all(std::vector<T>& result)
+    {
+        std::unique_lock<Lock> ulock(d_mutex);
+        d_cond.wait(ulock, [this](){ return !empty() || d_closed; });
+        return drain(result, ulock);
+    }
+
+    // Coroutine version of wait_and_pop, resumes on ex.
+    // co_await returns nullopt if the queue was closed and there are no elements left.
+    template <typename Executor>
+    pop_awaiter<threadsafe_queue, T, Executor> async_pop(Executor& ex)
+    {
+        return {*this, ex};
+    }
+
+    // Wakes up all the waiting producers and consumers.
+    void close()
+    {
+        std::unique_lock<Lock> ulock(d_mutex);
+        d_closed = true;
+        pop_waiter_list<T> waiters = std::exchange(d_waiters, {});
+        ulock.unlock();
+
+        d_cond.notify_all();
+        d_not_full.notify_all();
+        waiters.wake_all();
+    }
+
+    bool closed() const
+    {
+        std::lock_guard<Lock> guard(d_mutex);
+        return d_closed;
+    }
+
     bool empty() const noexcept
     {
         return d_queue.empty();
     }
 
+    size_t size() const
+    {
+        std::lock_guard<Lock> guard(d_mutex);
+        return d_queue.size();
+    }
+
+    size_t capacity() const noexcept
+    {
+        return d_capacity;
+    }
+
 private:
-    std::queue<T>           d_queue;
-    mutable std::mutex      d_mutex;
-    std::condition_variable d_cond;
+    template <typename, typename, typename>
+    friend class pop_awaiter;
+
+    bool bounded() const noexcept
+    {
+        return d_capacity != std::numeric_limits<size_t>::max();
+    }
+
+    void wait_not_full(std::unique_lock<Lock>& ulock)
+    {
+        if (bounded())
+            d_not_full.wait(ulock, [this](){ return d_queue.size() < d_capacity || d_closed; });
+    }
+
+    template <typename ... Args>
+    bool try_emplace(Args&&... args)
+    {
+        std::unique_lock<Lock> ulock(d_mutex);
+        if (d_closed || d_queue.size() >= d_capacity)
+            return false;
+
+        if (pop_waiter<T>* w = hand_off(std::forward<Args>(args)...))
+        {
+            ulock.unlock();
+            w->wake();
+            return true;
+        }
+
+        d_queue.emplace(std::forward<Args>(args)...);
+        ulock.unlock();
+
+        d_cond.notify_one();
+        return true;
+    }
+
+    // Unlocks, then wakes up the coroutines that were handed an element and
+    // the threads waiting for the queued ones.
+    void notify_pushed(std::unique_lock<Lock>& ulock, pop_waiter_list<T>& woken, size_t& queued)
+    {
+        ulock.unlock();
+        woken.wake_all();
+        if (queued > 1)
+            d_cond.notify_all();
+        else if (queued == 1)
+            d_cond.notify_one();
+        queued = 0;
+    }
+
+    // Gives the element to the oldest suspended coroutine, if there is one.
+    // The caller wakes it up after unlocking.
+    template <typename ... Args>
+    pop_waiter<T>* hand_off(Args&&... args)
+    {
+        if (d_waiters.empty())
+            return nullptr;
+
+        pop_waiter<T>* w = d_waiters.front();
+        w->value.emplace(std::forward<Args>(args)...);
+        d_waiters.pop_front();
+        return w;
+    }
+
+    // Called by async_pop's awaiter. Returns false if the coroutine doesn't
+    // need to suspend: there is an element, or the queue is closed.
+    bool suspend_pop(pop_waiter<T>& w)
+    {
+        std::unique_lock<Lock> ulock(d_mutex);
+        if (!empty())
+        {
+            w.value.emplace(std::move(d_queue.front()));
+            pop_front(ulock);
+            return false;
+        }
+        if (d_closed)
+            return false;
+
+        d_waiters.push_back(&w);
+        return true;
+    }
+
+    // Unlocks before notifying the producers waiting for space.
+    void pop_front(std::unique_lock<Lock>& ulock)
+    {
+        d_queue.pop();
+        ulock.unlock();
+
+        if (bounded())
+            d_not_full.notify_one();
+    }
+
+    size_t drain(std::vector<T>& result, std::unique_lock<Lock>& ulock)
+    {
+        const size_t count = d_queue.size();
+        result.reserve(result.size() + count);
+        while (!d_queue.empty())
+        {
+            result.push_back(std::move(d_queue.front()));
+            d_queue.pop();
+        }
+        ulock.unlock();
+
+        if (bounded() && count)
+            d_not_full.notify_all();
+        return count;
+    }
+
+    std::queue<T>      d_queue;
+    size_t             d_capacity = std::numeric_limits<size_t>::max();
+    bool               d_closed = false;
+    mutable Lock       d_mutex;
+    Condition          d_cond;
+    Condition          d_not_full;
+    pop_waiter_list<T> d_waiters;
 };
 
 
 } // namespace si
 
 #endif
-
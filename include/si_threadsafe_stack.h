@@ -4,68 +4,107 @@
 #include <exception>
 #include <memory>
 #include <mutex>
+#include <optional>
 #include <stack>
+#include <utility>
 
 namespace si {
 
 
-template <class T>
+// Lock is any Lockable, e.g. si::profiled_lock<std::mutex>.
+template <class T, class Lock = std::mutex>
 class threadsafe_stack
 {
 public:
     threadsafe_stack()
     {}
 
-    threadsafe_stack(const threadsafe_stack<T>& other)
+    threadsafe_stack(const threadsafe_stack& other)
     {
-        std::lock_guard<std::mutex> guard(other.d_mutex);
+        std::lock_guard<Lock> guard(other.d_mutex);
         d_stack = other.d_stack;
     }
 
-    threadsafe_stack& operator= (const threadsafe_stack<T>& other) = delete;
+    threadsafe_stack& operator= (const threadsafe_stack& other) = delete;
 
     void push(const T& val)
     {
-        std::lock_guard<std::mutex> guard(d_mutex);
+        std::lock_guard<Lock> guard(d_mutex);
         d_stack.push(val);
     }
 
+    void push(T&& val)
+    {
+        std::lock_guard<Lock> guard(d_mutex);
+        d_stack.push(std::move(val));
+    }
+
+    template <typename ... Args>
+    void emplace(Args&&... args)
+    {
+        std::lock_guard<Lock> guard(d_mutex);
+        d_stack.emplace(std::forward<Args>(args)...);
+    }
+
     // Combine top and pop to avoid race conditions.
     // Return by value might throw after we already popped from the stack,
     // so we return by pointer or reference instead.
     std::shared_ptr<T> pop()
     {
-        std::lock_guard<std::mutex> guard(d_mutex);
+        std::lock_guard<Lock> guard(d_mutex);
         if (empty())
             throw std::runtime_error("Empty stack.");
 
-        const auto sptr = std::make_shared<T>(d_stack.top());
+        const auto sptr = std::make_shared<T>(std::move(d_stack.top()));
         d_stack.pop();
         return sptr;
     }
 
     void pop(T& result)
     {
-        std::lock_guard<std::mutex> guard(d_mutex);
+        std::lock_guard<Lock> guard(d_mutex);
         if (empty())
             throw std::runtime_error("Empty stack.");
 
-        result = d_stack.top();
+        result = std::move(d_stack.top());
         d_stack.pop();
     }
 
+    // The try_pop overloads neither allocate nor throw on an empty stack.
+    bool try_pop(T& result)
+    {
+        std::lock_guard<Lock> guard(d_mutex);
+        if (empty())
+            return false;
+
+        result = std::move(d_stack.top());
+        d_stack.pop();
+        return true;
+    }
+
+    // The value is only popped after it was moved into the optional.
+    std::optional<T> try_pop()
+    {
+        std::lock_guard<Lock> guard(d_mutex);
+        if (empty())
+            return std::nullopt;
+
+        std::optional<T> res(std::move(d_stack.top()));
+        d_stack.pop();
+        return res;
+    }
+
     bool empty() const noexcept
     {
         return d_stack.empty();
     }
 
 private:
-    std::stack<T>      d_stack;
-    mutable std::mutex d_mutex;
+    std::stack<T> d_stack;
+    mutable Lock  d_mutex;
 };
 
 
 } // namespace si
 
 #endif
-
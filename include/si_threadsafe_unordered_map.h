@@ -9,18 +9,19 @@
 
 namespace si {
 
-// Hide the bucket type in an anonymous namespace so it's only visible
-// in this translation unit. If we made it a private class inside the map
-// then we would have one bucket_type class for each specialization of Hash.
-namespace {
+// Keep the bucket type out of the map. If we made it a private class inside
+// the map then we would have one bucket_type class for each specialization
+// of Hash. Not an anonymous namespace, since the map that holds buckets has
+// external linkage.
+namespace detail {
 
-template <typename Key, typename Value>
+template <typename Key, typename Value, typename SharedMutex>
 class bucket
 {
 public:
     std::shared_ptr<Value> find(const Key& k) const
     {
-        std::shared_lock<std::shared_mutex> slock(d_mutex);
+        std::shared_lock<SharedMutex> slock(d_mutex);
         for (const auto& p : d_nodes)
             if (p.first == k)
                 return p.second;
@@ -30,7 +31,7 @@ public:
 
     void insert(const Key& k, const std::shared_ptr<Value>& val)
     {
-        std::lock_guard<std::shared_mutex> guard(d_mutex);
+        std::lock_guard<SharedMutex> guard(d_mutex);
         for (const auto& p : d_nodes)
             if (p.first == k)
                 return;
@@ -40,7 +41,7 @@ public:
 
     void insert_or_update(const Key& k, const std::shared_ptr<Value>& val)
     {
-        std::lock_guard<std::shared_mutex> guard(d_mutex);
+        std::lock_guard<SharedMutex> guard(d_mutex);
         for (auto& p : d_nodes)
         {
             if (p.first == k)
@@ -55,7 +56,7 @@ public:
 
     void erase(const Key& k)
     {
-        std::lock_guard<std::shared_mutex> guard(d_mutex);
+        std::lock_guard<SharedMutex> guard(d_mutex);
         for (auto it = d_nodes.begin(); it != d_nodes.end(); ++ it)
         {
             if (it->first == k)
@@ -70,19 +71,22 @@ private:
     // Hold shared_ptrs so we avoid copying large value objects.
     // Also allows the bucket to hold objects that are not copyable.
     std::list<std::pair<Key, std::shared_ptr<Value>>> d_nodes;
-    mutable std::shared_mutex                         d_mutex;
+    mutable SharedMutex                               d_mutex;
 };
 
-} // close anonymous namespace
+} // namespace detail
 
+// SharedMutex is the lock of each bucket, e.g. si::rw_spinlock when the
+// critical sections are short and mostly reads.
 template<
     typename Key
   , typename Value
   , typename Hash = std::hash<Key>
+  , typename SharedMutex = std::shared_mutex
 > class threadsafe_unordered_map
 {
 public:
-    threadsafe_unordered_map<Key, Value, Hash>(size_t num_buckets = 5)
+    threadsafe_unordered_map(size_t num_buckets = 5)
         : d_buckets(num_buckets)
         , d_hasher(Hash())
     {}
@@ -110,7 +114,7 @@ public:
     }
 
 private:
-    using bucket_type = bucket<Key, Value>;
+    using bucket_type = detail::bucket<Key, Value, SharedMutex>;
 
     // find uses a const bucket_type&
     const bucket_type& get_bucket(const Key& k) const
@@ -122,7 +126,7 @@ private:
     bucket_type& get_bucket(const Key& k)
     {
         return const_cast<bucket_type&>(
-            static_cast< const threadsafe_unordered_map<Key, Value, Hash> * >(this)->get_bucket(k));
+            static_cast< const threadsafe_unordered_map * >(this)->get_bucket(k));
     }
 
     std::vector<bucket_type> d_buckets;
@@ -0,0 +1,196 @@
+#ifndef SI_TWO_LOCK_QUEUE_H
+#define SI_TWO_LOCK_QUEUE_H
+
+#include <si_node_freelist.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <utility>
+
+namespace si {
+
+// Queue with separate locks for the head and the tail, from
+// "Simple, Fast, and Practical Non-Blocking and Blocking Concurrent Queue Algorithms"
+// by Michael and Scott, also Concurrency In Action, Second Edition, Chapter 6.2.3.
+// https://www.cs.rochester.edu/u/scott/papers/1996_PODC_queues.pdf
+//
+// The head always points to a dummy node and the values live in the nodes
+// after it, so producers only touch the tail and consumers only touch the
+// head. A producer and a consumer never wait for each other, only for other
+// producers or consumers respectively.
+//
+// Nodes come from a node_freelist, so there are no allocations in steady state.
+template <class T>
+class two_lock_queue
+{
+public:
+    two_lock_queue()
+        : d_head(d_pool.create())
+        , d_tail(d_head)
+    {}
+
+    two_lock_queue(const two_lock_queue&) = delete;
+    two_lock_queue& operator= (const two_lock_queue&) = delete;
+
+    // Assumes no other thread is using the queue anymore.
+    ~two_lock_queue()
+    {
+        node* cur = d_head->next.load(std::memory_order_relaxed);
+        d_pool.destroy(d_head);
+        while (cur)
+        {
+            node* next = cur->next.load(std::memory_order_relaxed);
+            cur->value()->~T();
+            d_pool.destroy(cur);
+            cur = next;
+        }
+    }
+
+    void push(const T& val)
+    {
+        emplace(val);
+    }
+
+    void push(T&& val)
+    {
+        emplace(std::move(val));
+    }
+
+    // The value is constructed before taking the tail lock.
+    template <typename ... Args>
+    void emplace(Args&&... args)
+    {
+        node* new_node = d_pool.create();
+        try
+        {
+            new (&new_node->storage) T(std::forward<Args>(args)...);
+        }
+        catch (...)
+        {
+            d_pool.destroy(new_node);
+            throw;
+        }
+
+        {
+            std::lock_guard<std::mutex> guard(d_tail_mutex);
+            // seq_cst so that either we see the waiter or the waiter sees the node
+            d_tail->next.store(new_node, std::memory_order_seq_cst);
+            d_tail = new_node;
+        }
+
+        // Only take the head lock if a consumer might be waiting. Taking it
+        // makes sure the waiter is either inside wait() or will see the node.
+        if (d_waiters.load(std::memory_order_seq_cst) > 0)
+        {
+            { std::lock_guard<std::mutex> guard(d_head_mutex); }
+            d_cond.notify_one();
+        }
+    }
+
+    void wait_and_pop(T& result)
+    {
+        std::unique_lock<std::mutex> ulock(d_head_mutex);
+        wait_for_data(ulock);
+        pop_head(result, ulock);
+    }
+
+    std::shared_ptr<T> wait_and_pop()
+    {
+        std::unique_lock<std::mutex> ulock(d_head_mutex);
+        wait_for_data(ulock);
+        return pop_head(ulock);
+    }
+
+    bool try_pop(T& result)
+    {
+        std::unique_lock<std::mutex> ulock(d_head_mutex);
+        if (!d_head->next.load(std::memory_order_acquire))
+            return false;
+
+        pop_head(result, ulock);
+        return true;
+    }
+
+    std::shared_ptr<T> try_pop()
+    {
+        std::unique_lock<std::mutex> ulock(d_head_mutex);
+        if (!d_head->next.load(std::memory_order_acquire))
+            return nullptr;
+
+        return pop_head(ulock);
+    }
+
+    bool empty() const
+    {
+        std::lock_guard<std::mutex> guard(d_head_mutex);
+        return !d_head->next.load(std::memory_order_acquire);
+    }
+
+private:
+    struct node
+    {
+        // Written by a producer while a consumer might be reading it.
+        std::atomic<node*> next{nullptr};
+        // The value is constructed by push and destroyed by pop, the dummy node has none.
+        alignas(T) unsigned char storage[sizeof(T)];
+
+        T* value() noexcept
+        {
+            return std::launder(reinterpret_cast<T*>(&storage));
+        }
+    };
+
+    void wait_for_data(std::unique_lock<std::mutex>& ulock)
+    {
+        d_waiters.fetch_add(1, std::memory_order_seq_cst);
+        d_cond.wait(ulock, [this]() { return d_head->next.load(std::memory_order_seq_cst) != nullptr; });
+        d_waiters.fetch_sub(1, std::memory_order_relaxed);
+    }
+
+    // The node after the head becomes the new dummy. Its value is destroyed
+    // under the lock, since once we unlock, another consumer can recycle it.
+    void pop_head(T& result, std::unique_lock<std::mutex>& ulock)
+    {
+        node* old_head = d_head;
+        node* new_head = old_head->next.load(std::memory_order_acquire);
+        result = std::move(*new_head->value());
+        new_head->value()->~T();
+        d_head = new_head;
+        ulock.unlock();
+
+        d_pool.destroy(old_head);
+    }
+
+    std::shared_ptr<T> pop_head(std::unique_lock<std::mutex>& ulock)
+    {
+        node* old_head = d_head;
+        node* new_head = old_head->next.load(std::memory_order_acquire);
+        // If this throws, the value stays in the queue
+        auto res = std::make_shared<T>(std::move(*new_head->value()));
+        new_head->value()->~T();
+        d_head = new_head;
+        ulock.unlock();
+
+        d_pool.destroy(old_head);
+        return res;
+    }
+
+    node_freelist<node>     d_pool;
+
+    // Consumer side
+    alignas(64) mutable std::mutex d_head_mutex;
+    node*                   d_head;
+    std::condition_variable d_cond;
+    std::atomic<unsigned>   d_waiters{0};
+
+    // Producer side, on another cache line
+    alignas(64) std::mutex  d_tail_mutex;
+    node*                   d_tail;
+};
+
+} // namespace si
+
+#endif
@@ -76,7 +76,7 @@ private:
         _NodeBase<_NodeType>& operator=(const _NodeBase<_NodeType>& other) = default;
 
         // We might destroy a _NodeType* through a _NodeBase<_NodeType>*
-        virtual ~_NodeBase<_NodeType>()
+        virtual ~_NodeBase()
         {}
     };
 
@@ -0,0 +1,179 @@
+#ifndef SI_WORK_STEALING_DEQUE_H
+#define SI_WORK_STEALING_DEQUE_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <type_traits>
+#include <vector>
+
+namespace si {
+
+// Chase-Lev work-stealing deque.
+// https://www.dre.vanderbilt.edu/~schmidt/PDF/work-stealing-dequeue.pdf
+// With the memory orders from "Correct and Efficient Work-Stealing for Weak
+// Memory Models" by Lê, Pop, Cohen and Zappa Nardelli.
+// https://fzn.fr/readings/ppopp13.pdf
+//
+// The owner thread pushes and pops at the bottom (LIFO, good for locality),
+// other threads steal from the top (FIFO, the oldest and usually biggest tasks).
+// The owner only contends with thieves for the last element.
+//
+// The storage is a circular array that the owner doubles when it's full.
+// A thief might still be reading from the old array, so old arrays are only
+// freed with the deque.
+//
+// T must be trivially copyable (e.g. a pointer to a task): thieves read the
+// slot before knowing whether they won it.
+template <class T>
+class work_stealing_deque
+{
+    static_assert(std::is_trivially_copyable<T>::value, "T must be trivially copyable");
+
+public:
+    // The capacity is rounded up to a power of two.
+    explicit work_stealing_deque(size_t capacity = 64)
+    {
+        size_t cap = 1;
+        while (cap < capacity)
+            cap <<= 1;
+
+        d_buffers.push_back(std::make_unique<buffer>(cap));
+        d_buffer.store(d_buffers.back().get(), std::memory_order_relaxed);
+    }
+
+    work_stealing_deque(const work_stealing_deque&) = delete;
+    work_stealing_deque& operator= (const work_stealing_deque&) = delete;
+
+    // Owner only.
+    void push(T val)
+    {
+        const int64_t b = d_bottom.load(std::memory_order_relaxed);
+        const int64_t t = d_top.load(std::memory_order_acquire);
+        buffer* buf = d_buffer.load(std::memory_order_relaxed);
+        if (b - t > static_cast<int64_t>(buf->mask))
+            buf = grow(buf, t, b);
+
+        buf->put(b, val);
+        // A release store instead of the paper's release fence and relaxed
+        // store, same guarantee for the slot and visible to ThreadSanitizer.
+        d_bottom.store(b + 1, std::memory_order_release);
+    }
+
+    // Owner only. Returns the most recently pushed element, or nullopt if
+    // the deque is empty (or a thief took the last element).
+    std::optional<T> pop()
+    {
+        const int64_t b = d_bottom.load(std::memory_order_relaxed) - 1;
+        buffer* buf = d_buffer.load(std::memory_order_relaxed);
+        d_bottom.store(b, std::memory_order_relaxed);
+        // Thieves either see the decremented bottom, or we see their top.
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int64_t t = d_top.load(std::memory_order_relaxed);
+
+        if (t > b)
+        {
+            d_bottom.store(b + 1, std::memory_order_relaxed);
+            return std::nullopt;
+        }
+
+        std::optional<T> res(buf->get(b));
+        if (t == b)
+        {
+            // Last element, race the thieves for it
+            if (!d_top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst,
+                                               std::memory_order_relaxed))
+                res.reset();
+            d_bottom.store(b + 1, std::memory_order_relaxed);
+        }
+        return res;
+    }
+
+    // Any thread. Returns the oldest element, or nullopt if the deque is
+    // empty or another thread took it first.
+    std::optional<T> steal()
+    {
+        int64_t t = d_top.load(std::memory_order_acquire);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        const int64_t b = d_bottom.load(std::memory_order_acquire);
+        if (t >= b)
+            return std::nullopt;
+
+        // memory_order_consume in the paper, compilers treat it as acquire anyway
+        buffer* buf = d_buffer.load(std::memory_order_acquire);
+        const T val = buf->get(t);
+        if (!d_top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst,
+                                           std::memory_order_relaxed))
+            return std::nullopt;
+        return val;
+    }
+
+    // Only a snapshot when called from a thief.
+    size_t size() const noexcept
+    {
+        const int64_t b = d_bottom.load(std::memory_order_relaxed);
+        const int64_t t = d_top.load(std::memory_order_relaxed);
+        return b > t ? static_cast<size_t>(b - t) : 0;
+    }
+
+    bool empty() const noexcept
+    {
+        return size() == 0;
+    }
+
+    // Owner only.
+    size_t capacity() const noexcept
+    {
+        return d_buffer.load(std::memory_order_relaxed)->mask + 1;
+    }
+
+private:
+    // Slots are atomics because a thief can read a slot while the owner
+    // writes it one lap later, the CAS on top then makes the thief discard it.
+    struct buffer
+    {
+        explicit buffer(size_t capacity)
+            : mask(capacity - 1)
+            , slots(new std::atomic<T>[capacity])
+        {}
+
+        T get(int64_t i) const noexcept
+        {
+            return slots[i & mask].load(std::memory_order_relaxed);
+        }
+
+        void put(int64_t i, T val) noexcept
+        {
+            slots[i & mask].store(val, std::memory_order_relaxed);
+        }
+
+        const size_t                      mask;
+        std::unique_ptr<std::atomic<T>[]> slots;
+    };
+
+    // Copies [t, b) into a buffer twice as big and publishes it.
+    buffer* grow(buffer* old, int64_t t, int64_t b)
+    {
+        d_buffers.push_back(std::make_unique<buffer>(2 * (old->mask + 1)));
+        buffer* buf = d_buffers.back().get();
+        for (int64_t i = t; i != b; ++ i)
+            buf->put(i, old->get(i));
+
+        d_buffer.store(buf, std::memory_order_release);
+        return buf;
+    }
+
+    // Thieves CAS top, the owner only writes bottom. On separate cache lines.
+    alignas(64) std::atomic<int64_t> d_top{0};
+    alignas(64) std::atomic<int64_t> d_bottom{0};
+    std::atomic<buffer*>             d_buffer;
+
+    // All the buffers ever used, owner only.
+    std::vector<std::unique_ptr<buffer>> d_buffers;
+};
+
+} // namespace si
+
+#endif
@@ -0,0 +1,89 @@
+#include <gtest/gtest.h>
+
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <si_broadcast_ring.h>
+
+TEST(BroadcastRingShould, RoundUpCapacityToPowerOfTwo)
+{
+    EXPECT_EQ((si::broadcast_ring<int>(1, 1).capacity()), 1u);
+    EXPECT_EQ((si::broadcast_ring<int>(5, 1).capacity()), 8u);
+    EXPECT_THROW((si::broadcast_ring<int>(4, 0)), std::invalid_argument);
+}
+
+TEST(BroadcastRingShould, DeliverEveryEventToEveryConsumer)
+{
+    si::broadcast_ring<std::string> ring(4, 2);
+    EXPECT_EQ(ring.try_consume(0, [](const std::string&) {}), 0u);
+
+    ring.publish("a");
+    ring.publish_with([](std::string& slot) { slot.assign(2, 'b'); });
+
+    std::vector<std::string> seen[2];
+    EXPECT_EQ(ring.try_consume(0, [&seen](const std::string& s) { seen[0].push_back(s); }), 2u);
+    EXPECT_EQ(ring.consume(1, [&seen](const std::string& s) { seen[1].push_back(s); }), 2u);
+
+    const std::vector<std::string> expected = {"a", "bb"};
+    EXPECT_EQ(seen[0], expected);
+    EXPECT_EQ(seen[1], expected);
+}
+
+TEST(BroadcastRingShould, NotOverwriteUnreadEvents)
+{
+    si::broadcast_ring<int> ring(4, 2);
+    for (int i = 0; i < 4; ++ i)
+        EXPECT_TRUE(ring.try_publish(i));
+
+    // Full until the slowest consumer reads
+    EXPECT_FALSE(ring.try_publish(4));
+    int last = -1;
+    EXPECT_EQ(ring.try_consume(0, [&last](int v) { last = v; }), 4u);
+    EXPECT_EQ(last, 3);
+    EXPECT_FALSE(ring.try_publish(4));
+
+    EXPECT_EQ(ring.try_consume(1, [&last](int v) { last = v; }), 4u);
+    EXPECT_TRUE(ring.try_publish(4));
+    EXPECT_EQ(ring.try_consume(1, [&last](int v) { last = v; }), 1u);
+    EXPECT_EQ(last, 4);
+}
+
+template <typename WaitStrategy>
+void fan_out(int num_consumers)
+{
+    const long long num_events = 100000;
+    si::broadcast_ring<long long, WaitStrategy> ring(64, num_consumers);
+
+    // Each consumer checks that it sees all the events in order.
+    std::vector<std::thread> consumers;
+    std::vector<long long> sums(num_consumers, 0);
+    for (int c = 0; c < num_consumers; ++ c)
+        consumers.emplace_back([&ring, &sums, c, num_events]() {
+            long long expected = 0;
+            while (expected < num_events)
+                ring.consume(c, [&](long long v) {
+                    EXPECT_EQ(v, expected);
+                    ++ expected;
+                    sums[c] += v;
+                });
+        });
+
+    for (long long i = 0; i < num_events; ++ i)
+        ring.publish(i);
+
+    for (auto& c : consumers)
+        c.join();
+    for (long long sum : sums)
+        EXPECT_EQ(sum, num_events * (num_events - 1) / 2);
+}
+
+TEST(BroadcastRingShould, BeThreadSafe)
+{
+    fan_out<si::yielding_wait>(4);
+    fan_out<si::blocking_wait>(4);
+    // Spinning threads would starve each other without a core each.
+    if (std::thread::hardware_concurrency() >= 3)
+        fan_out<si::busy_spin_wait>(2);
+}
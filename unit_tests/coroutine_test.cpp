@@ -0,0 +1,159 @@
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <future>
+#include <memory>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <si_coroutine.h>
+#include <si_spmc_queue.h>
+#include <si_thread_pool.h>
+#include <si_threadsafe_queue.h>
+
+namespace {
+
+si::task<int> answer()
+{
+    co_return 42;
+}
+
+si::task<std::unique_ptr<int>> add(int a)
+{
+    const int b = co_await answer();
+    co_return std::make_unique<int>(a + b);
+}
+
+si::task<void> fail()
+{
+    co_await answer();
+    throw std::runtime_error("task failed");
+}
+
+// Runs the coroutines on the thread that resumes them
+struct inline_executor
+{
+    template <typename F>
+    void post(F f)
+    {
+        f();
+    }
+};
+
+template <typename Queue>
+si::task<std::optional<std::string>> pop_one(Queue& q, si::thread_pool& pool)
+{
+    co_return co_await q.async_pop(pool);
+}
+
+}
+
+TEST(CoroutineShould, ChainTasks)
+{
+    EXPECT_EQ(si::sync_wait(answer()), 42);
+    EXPECT_EQ(*si::sync_wait(add(1)), 43);
+    EXPECT_THROW(si::sync_wait(fail()), std::runtime_error);
+}
+
+TEST(CoroutineShould, MoveToTheExecutor)
+{
+    si::thread_pool pool(2);
+    const auto caller = std::this_thread::get_id();
+    const auto resumed_on = si::sync_wait([](si::thread_pool& pool) -> si::task<std::thread::id> {
+        co_await si::schedule(pool);
+        co_return std::this_thread::get_id();
+    }(pool));
+    EXPECT_NE(resumed_on, caller);
+}
+
+TEST(CoroutineShould, PopFromThreadsafeQueue)
+{
+    si::thread_pool pool(2);
+    si::threadsafe_queue<std::string> q;
+
+    // Doesn't suspend when there is an element
+    q.push("a");
+    EXPECT_EQ(si::sync_wait(pop_one(q, pool)), "a");
+
+    // Suspends until the push
+    std::promise<std::optional<std::string>> popped;
+    auto f = popped.get_future();
+    si::spawn(pool, [](si::threadsafe_queue<std::string>& q, si::thread_pool& pool,
+                       std::promise<std::optional<std::string>>& popped) -> si::task<void> {
+        popped.set_value(co_await q.async_pop(pool));
+    }(q, pool, popped));
+    EXPECT_EQ(f.wait_for(std::chrono::milliseconds(10)), std::future_status::timeout);
+
+    q.push("b");
+    EXPECT_EQ(f.get(), "b");
+    // Handed to the coroutine, not queued
+    EXPECT_TRUE(q.empty());
+
+    q.close();
+    EXPECT_EQ(si::sync_wait(pop_one(q, pool)), std::nullopt);
+}
+
+TEST(CoroutineShould, PopFromSpmcQueue)
+{
+    si::thread_pool pool(2);
+    si::spmc_fifo_queue<std::string> q;
+    q.push("a");
+    EXPECT_EQ(si::sync_wait(pop_one(q, pool)), "a");
+
+    q.close();
+    EXPECT_EQ(si::sync_wait(pop_one(q, pool)), std::nullopt);
+}
+
+TEST(CoroutineShould, SuspendManyConsumersOnFewThreads)
+{
+    const int num_consumers = 10000;
+    si::thread_pool pool(2);
+    si::threadsafe_queue<int> q;
+    std::atomic<long long> sum{0};
+    std::atomic<int> done{0};
+
+    auto consumer = [](si::threadsafe_queue<int>& q, si::thread_pool& pool,
+                       std::atomic<long long>& sum, std::atomic<int>& done) -> si::task<void> {
+        while (std::optional<int> val = co_await q.async_pop(pool))
+            sum += *val;
+        ++ done;
+    };
+    for (int i = 0; i < num_consumers; ++ i)
+        si::spawn(pool, consumer(q, pool, sum, done));
+
+    std::vector<int> values(num_consumers);
+    for (int i = 0; i < num_consumers; ++ i)
+        values[i] = i;
+    q.push_bulk(values.begin(), values.end());
+    for (int i = 0; i < num_consumers; ++ i)
+        q.push(i);
+
+    q.close();
+    while (done != num_consumers)
+        std::this_thread::yield();
+    EXPECT_EQ(sum, 2LL * num_consumers * (num_consumers - 1) / 2);
+}
+
+TEST(CoroutineShould, GetAllTheElementsOfABulkPush)
+{
+    inline_executor ex;
+    si::threadsafe_queue<int> q;
+    int consumed = 0;
+
+    // Resumed inside push_bulk, it suspends again before the other elements are pushed
+    si::spawn(ex, [](si::threadsafe_queue<int>& q, inline_executor& ex, int& consumed) -> si::task<void> {
+        while (co_await q.async_pop(ex))
+            ++ consumed;
+    }(q, ex, consumed));
+
+    const std::vector<int> values = {1, 2, 3, 4};
+    q.push_bulk(values.begin(), values.end());
+    EXPECT_EQ(consumed, 4);
+    EXPECT_EQ(q.size(), 0);
+
+    q.push_bulk(values.begin(), values.end());
+    EXPECT_EQ(consumed, 8);
+    q.close();
+}
@@ -0,0 +1,95 @@
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include <si_epoch_reclamation.h>
+
+namespace {
+
+struct counted
+{
+    static std::atomic<int> destroyed;
+    ~counted() { ++ destroyed; }
+};
+
+std::atomic<int> counted::destroyed{0};
+
+// Epochs can only advance one step per collect.
+void collect_all()
+{
+    for (int i = 0; i < 3; ++ i)
+        si::epoch_domain::instance().collect();
+}
+
+} // close anonymous namespace
+
+TEST(EpochReclamationShould, DeferDeleteWhilePinned)
+{
+    counted::destroyed = 0;
+    {
+        si::epoch_guard guard;
+        guard.retire(new counted);
+
+        // We are still pinned, so the epoch can't advance twice.
+        collect_all();
+        EXPECT_EQ(counted::destroyed, 0);
+    }
+
+    collect_all();
+    EXPECT_EQ(counted::destroyed, 1);
+}
+
+TEST(EpochReclamationShould, WaitForOtherPinnedThreads)
+{
+    counted::destroyed = 0;
+    std::atomic<bool> pinned{false};
+    std::atomic<bool> release{false};
+
+    std::thread reader([&]() {
+        si::epoch_guard guard;
+        pinned = true;
+        while (!release)
+            std::this_thread::yield();
+    });
+
+    while (!pinned)
+        std::this_thread::yield();
+
+    {
+        si::epoch_guard guard;
+        guard.retire(new counted);
+    }
+    collect_all();
+    EXPECT_EQ(counted::destroyed, 0);
+
+    release = true;
+    reader.join();
+
+    collect_all();
+    EXPECT_EQ(counted::destroyed, 1);
+}
+
+TEST(EpochReclamationShould, ReclaimWhatExitedThreadsRetired)
+{
+    counted::destroyed = 0;
+    const int num_threads = 8;
+    const int per_thread = 1000;
+
+    std::vector<std::thread> threads;
+    for (int i = 0; i < num_threads; ++ i)
+        threads.emplace_back([]() {
+            for (int j = 0; j < per_thread; ++ j)
+            {
+                si::epoch_guard guard;
+                guard.retire(new counted);
+            }
+        });
+
+    for (auto& t : threads)
+        t.join();
+
+    collect_all();
+    EXPECT_EQ(counted::destroyed, num_threads * per_thread);
+}
@@ -0,0 +1,88 @@
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <si_futex_condition.h>
+#include <si_spinlock_mutex.h>
+#include <si_threadsafe_queue.h>
+
+#ifdef __linux__
+TEST(FutexConditionShould, WakeUpWaiters)
+{
+    si::spinlock_amd m;
+    si::futex_condition cond;
+    bool ready = false;
+    int woken = 0;
+
+    std::vector<std::thread> waiters;
+    for (int i = 0; i < 3; ++ i)
+        waiters.emplace_back([&]() {
+            std::unique_lock<si::spinlock_amd> ulock(m);
+            cond.wait(ulock, [&ready]() { return ready; });
+            ++ woken;
+        });
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+
+    {
+        std::lock_guard<si::spinlock_amd> guard(m);
+        ready = true;
+    }
+    cond.notify_all();
+    for (auto& t : waiters)
+        t.join();
+    EXPECT_EQ(woken, 3);
+}
+
+TEST(FutexConditionShould, TimeOut)
+{
+    std::mutex m;
+    si::futex_condition cond;
+    std::unique_lock<std::mutex> ulock(m);
+
+    const auto start = std::chrono::steady_clock::now();
+    EXPECT_FALSE(cond.wait_for(ulock, std::chrono::milliseconds(20), []() { return false; }));
+    EXPECT_GE(std::chrono::steady_clock::now() - start, std::chrono::milliseconds(20));
+    EXPECT_TRUE(ulock.owns_lock());
+
+    EXPECT_TRUE(cond.wait_for(ulock, std::chrono::milliseconds(20), []() { return true; }));
+}
+
+TEST(FutexConditionShould, NotLoseWakeUpsOfBlockedConsumers)
+{
+    // Every push wakes up at most one consumer with notify_one, so a lost
+    // wake up leaves a consumer asleep with elements in the queue.
+    si::threadsafe_queue<int, si::spinlock_amd, si::futex_condition> q;
+    const int num_consumers = 8;
+    const int per_consumer = 10000;
+
+    std::vector<long long> sums(num_consumers, 0);
+    std::vector<std::thread> consumers;
+    for (int c = 0; c < num_consumers; ++ c)
+        consumers.emplace_back([&q, &sums, c]() {
+            for (int i = 0; i < per_consumer; ++ i)
+            {
+                int val = 0;
+                q.wait_and_pop(val);
+                sums[c] += val;
+            }
+        });
+
+    for (int i = 0; i < num_consumers * per_consumer; ++ i)
+    {
+        q.push(1);
+        // Lets the consumers drain the queue and go back to sleep
+        if (i % 64 == 0)
+            std::this_thread::yield();
+    }
+
+    for (auto& t : consumers)
+        t.join();
+    long long total = 0;
+    for (long long sum : sums)
+        total += sum;
+    EXPECT_EQ(total, num_consumers * per_consumer);
+}
+#endif
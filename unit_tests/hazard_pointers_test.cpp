@@ -0,0 +1,88 @@
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include <si_hazard_pointers.h>
+
+namespace {
+
+struct counted
+{
+    static std::atomic<int> destroyed;
+    ~counted() { ++ destroyed; }
+};
+
+std::atomic<int> counted::destroyed{0};
+
+} // close anonymous namespace
+
+TEST(HazardPointersShould, NotDeleteProtectedObjects)
+{
+    counted::destroyed = 0;
+    std::atomic<counted*> shared{new counted};
+
+    si::hazard_pointer hp;
+    counted* ptr = hp.protect(shared);
+    EXPECT_EQ(ptr, shared.load());
+
+    // Unlink and retire it while it's still protected
+    shared = nullptr;
+    {
+        si::hazard_pointer owner;
+        owner.retire(ptr);
+    }
+    si::hazard_pointer_domain::instance().collect();
+    EXPECT_EQ(counted::destroyed, 0);
+
+    hp.reset();
+    si::hazard_pointer_domain::instance().collect();
+    EXPECT_EQ(counted::destroyed, 1);
+}
+
+TEST(HazardPointersShould, OnlyHoldBackProtectedObjects)
+{
+    counted::destroyed = 0;
+    std::atomic<counted*> shared{new counted};
+    std::atomic<bool> protecting{false};
+    std::atomic<bool> release{false};
+
+    // A stalled reader only holds back the object it protects
+    std::thread reader([&]() {
+        si::hazard_pointer hp;
+        hp.protect(shared);
+        protecting = true;
+        while (!release)
+            std::this_thread::yield();
+    });
+
+    while (!protecting)
+        std::this_thread::yield();
+
+    si::hazard_pointer hp;
+    hp.retire(shared.exchange(nullptr));
+    for (int i = 0; i < 100; ++ i)
+        hp.retire(new counted);
+    si::hazard_pointer_domain::instance().collect();
+    EXPECT_EQ(counted::destroyed, 100);
+
+    release = true;
+    reader.join();
+
+    si::hazard_pointer_domain::instance().collect();
+    EXPECT_EQ(counted::destroyed, 101);
+}
+
+TEST(HazardPointersShould, ThrowWhenOutOfSlots)
+{
+    std::vector<std::unique_ptr<si::hazard_pointer>> hps;
+    for (size_t i = 0; i < si::hazard_pointer_domain::slots_per_thread; ++ i)
+        hps.push_back(std::make_unique<si::hazard_pointer>());
+
+    EXPECT_THROW(si::hazard_pointer(), std::runtime_error);
+
+    // Slots are given back on destruction
+    hps.pop_back();
+    EXPECT_NO_THROW(si::hazard_pointer());
+}
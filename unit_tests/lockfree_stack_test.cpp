@@ -1,5 +1,11 @@
 #include <gtest/gtest.h>
 
+#include <atomic>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
 #include <si_lockfree_stack.h>
 
 TEST(LockfreeStackShould, SupportPushAndPop)
@@ -10,3 +16,143 @@ TEST(LockfreeStackShould, SupportPushAndPop)
     ASSERT_TRUE(ptr);
     EXPECT_EQ(42, *ptr);
 }
+
+TEST(LockfreeStackShould, FreePoppedNodes)
+{
+    const size_t reclaimed = si::epoch_domain::instance().reclaimed();
+
+    si::lockfree_stack<int> s;
+    for (int i = 0; i < 1000; ++ i)
+    {
+        s.push(i);
+        s.pop();
+    }
+
+    for (int i = 0; i < 3; ++ i)
+        si::epoch_domain::instance().collect();
+    EXPECT_GE(si::epoch_domain::instance().reclaimed() - reclaimed, 1000u);
+}
+
+template <class Stack>
+void test_contention()
+{
+    Stack s;
+    const int num_threads = 8;
+    const int per_thread = 20000;
+
+    // Every thread pushes its own values and pops as many as it pushed,
+    // so popped nodes are retired while other threads are still reading.
+    std::atomic<long long> popped_sum{0};
+    std::vector<std::thread> threads;
+    for (int t = 0; t < num_threads; ++ t)
+        threads.emplace_back([&s, &popped_sum, t]() {
+            long long sum = 0;
+            for (int i = 0; i < per_thread; ++ i)
+            {
+                s.push(t * per_thread + i);
+                sum += *s.pop();
+            }
+            popped_sum += sum;
+        });
+
+    for (auto& t : threads)
+        t.join();
+
+    const long long n = num_threads * per_thread;
+    EXPECT_EQ(popped_sum, n * (n - 1) / 2);
+}
+
+TEST(LockfreeStackShould, NotLoseValuesUnderContention)
+{
+    test_contention<si::lockfree_stack<int, si::epoch_reclamation>>();
+    test_contention<si::lockfree_stack<int, si::hazard_pointer_reclamation>>();
+    test_contention<si::lockfree_stack<int, si::freelist_reclamation>>();
+    test_contention<si::lockfree_stack<int, si::leak_reclamation>>();
+}
+
+TEST(LockfreeStackShould, NotLoseValuesWithElimination)
+{
+    test_contention<si::lockfree_stack<int, si::epoch_reclamation, 4>>();
+    test_contention<si::lockfree_stack<int, si::hazard_pointer_reclamation, 4>>();
+    test_contention<si::lockfree_stack<int, si::freelist_reclamation, 4>>();
+}
+
+TEST(EliminationArrayShould, ExchangeBetweenPushAndPop)
+{
+    // With a single slot, a push and a pop always meet
+    si::elimination_array<int, 1> arr;
+    EXPECT_EQ(arr.try_pop(), nullptr);
+
+    int val = 42;
+    std::atomic<int*> popped{nullptr};
+    std::thread popper([&]() {
+        int* p = nullptr;
+        while (!p)
+            p = arr.try_pop();
+        popped = p;
+    });
+
+    while (!arr.try_push(&val));
+    popper.join();
+    EXPECT_EQ(popped, &val);
+}
+
+TEST(LockfreeStackShould, TryPop)
+{
+    si::lockfree_stack<std::string, si::freelist_reclamation> s;
+    std::string val;
+    EXPECT_FALSE(s.try_pop(val));
+
+    s.push("a");
+    s.push("b");
+    EXPECT_TRUE(s.try_pop(val));
+    EXPECT_EQ(val, "b");
+    EXPECT_TRUE(s.try_pop(val));
+    EXPECT_EQ(val, "a");
+    EXPECT_FALSE(s.try_pop(val));
+}
+
+TEST(LockfreeStackShould, EmplaceAndTryPopOptional)
+{
+    si::lockfree_stack<std::string, si::freelist_reclamation> s;
+    EXPECT_FALSE(s.try_pop());
+
+    s.emplace(3, 'a');
+    s.push(std::string("b"));
+    auto opt = s.try_pop();
+    ASSERT_TRUE(opt);
+    EXPECT_EQ(*opt, "b");
+    opt = s.try_pop();
+    ASSERT_TRUE(opt);
+    EXPECT_EQ(*opt, "aaa");
+    EXPECT_FALSE(s.try_pop());
+}
+
+TEST(LockfreeStackShould, SupportMoveOnlyTypes)
+{
+    si::lockfree_stack<std::unique_ptr<int>> s;
+    s.push(std::make_unique<int>(1));
+    s.emplace(new int(2));
+
+    std::unique_ptr<int> val;
+    EXPECT_TRUE(s.try_pop(val));
+    EXPECT_EQ(*val, 2);
+    auto opt = s.try_pop();
+    ASSERT_TRUE(opt);
+    EXPECT_EQ(**opt, 1);
+}
+
+TEST(LockfreeStackShould, FreePoppedNodesWithHazardPointers)
+{
+    const size_t reclaimed = si::hazard_pointer_domain::instance().reclaimed();
+
+    si::lockfree_stack<int, si::hazard_pointer_reclamation> s;
+    for (int i = 0; i < 1000; ++ i)
+    {
+        s.push(i);
+        s.pop();
+    }
+
+    si::hazard_pointer_domain::instance().collect();
+    EXPECT_GE(si::hazard_pointer_domain::instance().reclaimed() - reclaimed, 1000u);
+}
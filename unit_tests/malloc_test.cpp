@@ -2,6 +2,9 @@
 
 #include <si_malloc.h>
 
+#include <cstring>
+#include <vector>
+
 struct Node
 {
     double d;
@@ -95,3 +98,75 @@ TEST(MallocShould, DoMultipleAllocationsAndFrees)
 
     si::free(node);
 }
+
+TEST(MallocShould, ReuseFreedChunks)
+{
+    char* first = (char*)si::malloc(40);
+    ASSERT_TRUE(first);
+    // Keeps the freed chunk from coalescing with the rest of the heap
+    char* guard = (char*)si::malloc(40);
+    ASSERT_TRUE(guard);
+
+    si::free(first);
+    EXPECT_EQ(si::malloc(40), first);
+
+    si::free(first);
+    si::free(guard);
+}
+
+TEST(MallocShould, CoalesceNeighbours)
+{
+    char* a = (char*)si::malloc(100);
+    char* b = (char*)si::malloc(100);
+    char* c = (char*)si::malloc(100);
+    char* guard = (char*)si::malloc(100);
+    ASSERT_TRUE(a && b && c && guard);
+    ASSERT_EQ(b - a, c - b);
+
+    si::free(a);
+    si::free(c);
+    // Merges with both neighbours, so the three fit a bigger allocation
+    si::free(b);
+    char* merged = (char*)si::malloc(300);
+    EXPECT_EQ(merged, a);
+
+    si::free(merged);
+    si::free(guard);
+}
+
+TEST(MallocShould, KeepContentsWhenFragmented)
+{
+    const int count = 5000;
+    std::vector<unsigned char*> ptrs(count);
+    std::vector<size_t> sizes(count);
+
+    auto fill = [&](int i) {
+        sizes[i] = 1 + (i * 7919) % 2000;
+        ptrs[i] = (unsigned char*)si::malloc(sizes[i]);
+        ASSERT_TRUE(ptrs[i]);
+        EXPECT_EQ((uintptr_t)ptrs[i] % 8, 0);
+        memset(ptrs[i], i & 0xff, sizes[i]);
+    };
+    auto check = [&](int i) {
+        for (size_t j = 0; j < sizes[i]; ++ j)
+            ASSERT_EQ(ptrs[i][j], i & 0xff) << "allocation " << i;
+    };
+
+    for (int i = 0; i < count; ++ i)
+        fill(i);
+
+    // Leaves holes between the live chunks, then fills them with other sizes
+    for (int i = 0; i < count; i += 2)
+    {
+        check(i);
+        si::free(ptrs[i]);
+    }
+    for (int i = 0; i < count; i += 2)
+        fill(i);
+
+    for (int i = 0; i < count; ++ i)
+    {
+        check(i);
+        si::free(ptrs[i]);
+    }
+}
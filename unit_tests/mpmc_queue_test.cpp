@@ -0,0 +1,159 @@
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <si_mpmc_queue.h>
+
+TEST(MpmcQueueShould, RoundUpCapacityToPowerOfTwo)
+{
+    EXPECT_EQ(si::mpmc_queue<int>(0).capacity(), 2u);
+    EXPECT_EQ(si::mpmc_queue<int>(2).capacity(), 2u);
+    EXPECT_EQ(si::mpmc_queue<int>(5).capacity(), 8u);
+}
+
+TEST(MpmcQueueShould, FailWhenFullOrEmpty)
+{
+    si::mpmc_queue<std::string> q(4);
+    EXPECT_TRUE(q.empty());
+    EXPECT_FALSE(q.try_pop());
+
+    for (int i = 0; i < 4; ++ i)
+        EXPECT_TRUE(q.try_push(std::to_string(i)));
+    EXPECT_TRUE(q.full());
+
+    // Not moved from when the push fails
+    std::string val("4");
+    EXPECT_FALSE(q.try_push(std::move(val)));
+    EXPECT_EQ(val, "4");
+
+    // Wraps around
+    for (int lap = 0; lap < 3; ++ lap)
+        for (int i = 0; i < 4; ++ i)
+        {
+            auto res = q.try_pop();
+            ASSERT_TRUE(res);
+            EXPECT_EQ(*res, std::to_string(lap * 4 + i));
+            EXPECT_TRUE(q.try_emplace(std::to_string(lap * 4 + i + 4)));
+        }
+}
+
+TEST(MpmcQueueShould, DestroyRemainingValues)
+{
+    auto val = std::make_shared<int>(1);
+    {
+        si::mpmc_queue<std::shared_ptr<int>> q(4);
+        q.try_push(val);
+        q.try_push(val);
+        std::shared_ptr<int> popped;
+        EXPECT_TRUE(q.try_pop(popped));
+        EXPECT_EQ(val.use_count(), 3);
+    }
+    EXPECT_EQ(val.use_count(), 1);
+}
+
+TEST(MpmcQueueShould, BeThreadSafe)
+{
+    const int num_threads = 4;
+    const int per_thread = 20000;
+    si::mpmc_queue<int> q(64);
+
+    std::vector<std::thread> producers;
+    for (int t = 0; t < num_threads; ++ t)
+        producers.emplace_back([&q, t]() {
+            for (int i = 0; i < per_thread; ++ i)
+                while (!q.try_push(t * per_thread + i))
+                    std::this_thread::yield();
+        });
+
+    // Each consumer checks that the values of each producer come in order.
+    std::vector<std::future<long long>> consumers;
+    for (int t = 0; t < num_threads; ++ t)
+        consumers.push_back(std::async(std::launch::async, [&q]() {
+            std::vector<int> last(num_threads, -1);
+            long long sum = 0;
+            int val;
+            for (int i = 0; i < per_thread; ++ i)
+            {
+                while (!q.try_pop(val))
+                    std::this_thread::yield();
+                EXPECT_GT(val, last[val / per_thread]);
+                last[val / per_thread] = val;
+                sum += val;
+            }
+            return sum;
+        }));
+
+    for (auto& p : producers)
+        p.join();
+    long long sum = 0;
+    for (auto& c : consumers)
+        sum += c.get();
+
+    const long long n = num_threads * per_thread;
+    EXPECT_EQ(sum, n * (n - 1) / 2);
+    EXPECT_TRUE(q.empty());
+}
+
+TEST(BlockingMpmcQueueShould, BlockWhenFullOrEmpty)
+{
+    // GIVEN
+    si::blocking_mpmc_queue<std::unique_ptr<int>> q(2);
+    auto consumer = std::async(std::launch::async, [&q]() { return *q.pop(); });
+    EXPECT_EQ(consumer.wait_for(std::chrono::milliseconds(10)), std::future_status::timeout);
+
+    // WHEN
+    q.push(std::make_unique<int>(1));
+
+    // THEN
+    EXPECT_EQ(consumer.get(), 1);
+
+    // GIVEN
+    q.emplace(new int(2));
+    q.push(std::make_unique<int>(3));
+    EXPECT_FALSE(q.try_push(std::make_unique<int>(4)));
+    auto producer = std::async(std::launch::async, [&q]() { q.push(std::make_unique<int>(4)); });
+    EXPECT_EQ(producer.wait_for(std::chrono::milliseconds(10)), std::future_status::timeout);
+
+    // WHEN
+    std::unique_ptr<int> val;
+    q.pop(val);
+
+    // THEN
+    producer.get();
+    EXPECT_EQ(*val, 2);
+    EXPECT_EQ(*q.pop(), 3);
+    EXPECT_TRUE(q.try_pop(val));
+    EXPECT_EQ(*val, 4);
+}
+
+TEST(BlockingMpmcQueueShould, NotLoseWakeUps)
+{
+    const int num_threads = 4;
+    const int per_thread = 20000;
+    si::blocking_mpmc_queue<int> q(4);
+
+    std::vector<std::thread> threads;
+    std::atomic<long long> sum{0};
+    for (int t = 0; t < num_threads; ++ t)
+    {
+        threads.emplace_back([&q]() {
+            for (int i = 0; i < per_thread; ++ i)
+                q.push(i);
+        });
+        threads.emplace_back([&q, &sum]() {
+            for (int i = 0; i < per_thread; ++ i)
+                sum += q.pop();
+        });
+    }
+
+    for (auto& t : threads)
+        t.join();
+    EXPECT_EQ(sum, num_threads * (per_thread * (per_thread - 1LL) / 2));
+    EXPECT_TRUE(q.empty());
+}
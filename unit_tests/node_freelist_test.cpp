@@ -0,0 +1,65 @@
+#include <gtest/gtest.h>
+
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <si_node_freelist.h>
+
+TEST(NodeFreelistShould, ReuseDestroyedNodes)
+{
+    si::node_freelist<std::string> pool;
+    std::string* first = pool.create("first");
+    EXPECT_EQ(*first, "first");
+    pool.destroy(first);
+
+    std::string* second = pool.create("second");
+    EXPECT_EQ(second, first);
+    EXPECT_EQ(*second, "second");
+    pool.destroy(second);
+}
+
+TEST(NodeFreelistShould, GiveBackMemoryWhenConstructorThrows)
+{
+    struct throwing
+    {
+        throwing(bool do_throw)
+        {
+            if (do_throw)
+                throw std::runtime_error("throwing");
+        }
+    };
+
+    si::node_freelist<throwing> pool;
+    throwing* first = pool.create(false);
+    pool.destroy(first);
+
+    EXPECT_THROW(pool.create(true), std::runtime_error);
+    EXPECT_EQ(pool.create(false), first);
+    pool.destroy(first);
+}
+
+TEST(NodeFreelistShould, BeThreadSafe)
+{
+    si::node_freelist<int> pool;
+    const int num_threads = 8;
+    const int per_thread = 10000;
+
+    std::vector<std::thread> threads;
+    for (int t = 0; t < num_threads; ++ t)
+        threads.emplace_back([&pool, t]() {
+            for (int i = 0; i < per_thread; ++ i)
+            {
+                int* a = pool.create(t);
+                int* b = pool.create(i);
+                EXPECT_NE(a, b);
+                EXPECT_EQ(*a, t);
+                EXPECT_EQ(*b, i);
+                pool.destroy(a);
+                pool.destroy(b);
+            }
+        });
+
+    for (auto& t : threads)
+        t.join();
+}
@@ -0,0 +1,105 @@
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <sstream>
+#include <thread>
+
+#include <si_profiled_lock.h>
+#include <si_spinlock_mutex.h>
+#include <si_threadsafe_queue.h>
+#include <si_threadsafe_stack.h>
+#include <si_threadsafe_unordered_map.h>
+
+namespace {
+
+uint64_t total(const uint64_t (&histogram)[si::lock_stats::num_buckets])
+{
+    uint64_t sum = 0;
+    for (uint64_t count : histogram)
+        sum += count;
+    return sum;
+}
+
+}
+
+TEST(ProfiledLockShould, CountAcquisitions)
+{
+    {
+        si::profiled_lock<std::mutex> m("test_uncontended");
+        for (int i = 0; i < 10; ++ i)
+        {
+            std::lock_guard<si::profiled_lock<std::mutex>> guard(m);
+        }
+        EXPECT_TRUE(m.try_lock());
+        m.unlock();
+    }
+
+    // Kept after the lock is destroyed
+    const si::lock_site_stats stats = si::lock_registry::instance().site("test_uncontended");
+    EXPECT_EQ(stats.acquisitions, 11u);
+    EXPECT_EQ(stats.contended, 0u);
+    EXPECT_EQ(stats.spins, 0u);
+    // Only the 1st of every 16 holds is timed
+    EXPECT_EQ(total(stats.hold_cycles), 1u);
+    EXPECT_EQ(total(stats.wait_cycles), 0u);
+}
+
+TEST(ProfiledLockShould, MeasureContention)
+{
+    si::profiled_lock<si::spinlock_amd, "test_contended"> m;
+    m.lock();
+    std::thread waiter([&m]() {
+        std::lock_guard<si::profiled_lock<si::spinlock_amd, "test_contended">> guard(m);
+    });
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    m.unlock();
+    waiter.join();
+
+    const si::lock_site_stats stats = si::lock_registry::instance().site("test_contended");
+    EXPECT_EQ(stats.acquisitions, 2u);
+    EXPECT_EQ(stats.contended, 1u);
+    EXPECT_GE(stats.spins, 1u);
+    EXPECT_EQ(total(stats.wait_cycles), 1u);
+    // 20ms is way more than 2^20 cycles
+    EXPECT_GT(si::lock_site_stats::percentile(stats.wait_cycles, 0.5), uint64_t(1) << 20);
+    EXPECT_GT(si::lock_site_stats::percentile(stats.hold_cycles, 0.99), uint64_t(1) << 20);
+}
+
+TEST(ProfiledLockShould, ProfileTheContainerLocks)
+{
+    si::threadsafe_queue<int, si::profiled_lock<std::mutex, "test_queue">> q;
+    std::thread consumer([&q]() {
+        int val;
+        while (q.wait_and_pop(val))
+            ;
+    });
+    for (int i = 0; i < 100; ++ i)
+        q.push(i);
+    q.close();
+    consumer.join();
+    EXPECT_GE(si::lock_registry::instance().site("test_queue").acquisitions, 101u);
+
+    si::threadsafe_stack<int, si::profiled_lock<si::spinlock_mutex, "test_stack">> s;
+    s.push(1);
+    EXPECT_EQ(s.try_pop(), 1);
+    EXPECT_EQ(si::lock_registry::instance().site("test_stack").acquisitions, 2u);
+
+    // All the buckets share the site, finds take the shared lock
+    si::threadsafe_unordered_map<int, int, std::hash<int>,
+                                 si::profiled_lock<std::shared_mutex, "test_map">> m(8);
+    for (int i = 0; i < 20; ++ i)
+        m.insert(i, std::make_shared<int>(i));
+    for (int i = 0; i < 20; ++ i)
+        EXPECT_EQ(*m.find(i), i);
+    const si::lock_site_stats stats = si::lock_registry::instance().site("test_map");
+    EXPECT_EQ(stats.acquisitions, 40u);
+    // The first insert in each bucket, no bucket gets to 16 acquisitions
+    EXPECT_EQ(total(stats.hold_cycles), 8u);
+
+    std::ostringstream os;
+    si::lock_registry::instance().dump(os);
+    EXPECT_NE(os.str().find("test_map: acquisitions = 40"), std::string::npos);
+}
@@ -0,0 +1,112 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+#include <si_record_ring_buffer.h>
+
+TEST(RecordRingBufferShould, PushAndPopVariableLengthRecords)
+{
+    si::record_ring_buffer<> rb(64);
+    EXPECT_TRUE(rb.empty());
+    EXPECT_FALSE(rb.peek());
+
+    EXPECT_TRUE(rb.try_push("a", 1));
+    EXPECT_TRUE(rb.try_push("", 0));
+    EXPECT_TRUE(rb.try_push("0123456789", 10));
+
+    std::string val;
+    auto pop = [&val](const char* data, size_t size) { val.assign(data, size); };
+    EXPECT_TRUE(rb.try_pop(pop));
+    EXPECT_EQ(val, "a");
+    EXPECT_TRUE(rb.try_pop(pop));
+    EXPECT_EQ(val, "");
+
+    auto rec = rb.peek();
+    ASSERT_TRUE(rec);
+    EXPECT_EQ(reinterpret_cast<uintptr_t>(rec.data) % 8, 0u);
+    EXPECT_EQ(std::string(rec.data, rec.size), "0123456789");
+    rb.consume();
+    EXPECT_FALSE(rb.try_pop(pop));
+    EXPECT_TRUE(rb.empty());
+}
+
+TEST(RecordRingBufferShould, FailWhenFull)
+{
+    // 8 words: each 20 byte record takes 4 of them
+    si::record_ring_buffer<> rb(64);
+    const std::string rec(20, 'x');
+    EXPECT_TRUE(rb.try_push(rec.data(), rec.size()));
+    EXPECT_TRUE(rb.try_push(rec.data(), rec.size()));
+    EXPECT_FALSE(rb.try_push(rec.data(), rec.size()));
+    EXPECT_EQ(rb.reserve(1), nullptr);
+
+    EXPECT_EQ(rb.max_record_size(), 56u);
+    EXPECT_THROW(rb.reserve(57), std::length_error);
+}
+
+TEST(RecordRingBufferShould, SkipToTheBeginningInsteadOfSplitting)
+{
+    // GIVEN 8 words, with the tail 3 words before the end
+    si::record_ring_buffer<> rb(64);
+    const std::string small(8, 's');
+    EXPECT_TRUE(rb.try_push(small.data(), small.size()));
+    EXPECT_TRUE(rb.try_push(small.data(), small.size()));
+    EXPECT_TRUE(rb.try_pop([](const char*, size_t) {}));
+    EXPECT_TRUE(rb.try_pop([](const char*, size_t) {}));
+    EXPECT_TRUE(rb.try_push("x", 1));
+
+    // WHEN a 4 word record is written in place
+    const std::string big(24, 'b');
+    char* dst = rb.reserve(big.size());
+    ASSERT_NE(dst, nullptr);
+    std::memcpy(dst, big.data(), big.size());
+    rb.commit();
+
+    // THEN it is contiguous
+    std::string val;
+    auto pop = [&val](const char* data, size_t size) { val.assign(data, size); };
+    EXPECT_TRUE(rb.try_pop(pop));
+    EXPECT_EQ(val, "x");
+    EXPECT_TRUE(rb.try_pop(pop));
+    EXPECT_EQ(val, big);
+    EXPECT_TRUE(rb.empty());
+}
+
+TEST(RecordRingBufferShould, HandOffInOrderAcrossThreads)
+{
+    const uint32_t num_records = 100000;
+    si::record_ring_buffer<> rb(1024);
+
+    // Record i holds i, repeated i % 50 times
+    std::thread producer([&rb]() {
+        uint32_t buf[50];
+        for (uint32_t i = 0; i < num_records; ++ i)
+        {
+            const size_t count = i % 50;
+            std::fill(buf, buf + count, i);
+            while (!rb.try_push(buf, count * sizeof(uint32_t)))
+                std::this_thread::yield();
+        }
+    });
+
+    for (uint32_t i = 0; i < num_records; ++ i)
+    {
+        while (!rb.try_pop([i](const char* data, size_t size) {
+                   ASSERT_EQ(size, i % 50 * sizeof(uint32_t));
+                   for (size_t j = 0; j < i % 50; ++ j)
+                   {
+                       uint32_t val;
+                       std::memcpy(&val, data + j * sizeof(val), sizeof(val));
+                       ASSERT_EQ(val, i);
+                   }
+               }))
+            std::this_thread::yield();
+    }
+    producer.join();
+    EXPECT_TRUE(rb.empty());
+}
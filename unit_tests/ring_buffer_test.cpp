@@ -1,6 +1,12 @@
 #include <gtest/gtest.h>
 
+#include <algorithm>
 #include <cassert>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
 
 #include <si_ring_buffer.h>
 
@@ -28,3 +34,218 @@ TEST (si_ring_buffer, basic_ops)
     assert(20 == cb.pop_front());
     assert(0 == cb.size());
 }
+
+// Counts the live instances
+struct tracked
+{
+    static int live;
+    std::string val;
+
+    tracked(std::string v) : val(std::move(v)) { ++ live; }
+    tracked(const tracked& other) : val(other.val) { ++ live; }
+    tracked(tracked&& other) noexcept : val(std::move(other.val)) { ++ live; }
+    tracked& operator= (const tracked&) = default;
+    tracked& operator= (tracked&&) = default;
+    ~tracked() { -- live; }
+};
+int tracked::live = 0;
+
+TEST(RingBufferShould, DestroyElements)
+{
+    {
+        si::ring_buffer<tracked> rb(4);
+        rb.push_back(tracked("a"));
+        rb.emplace_back("b");
+        rb.emplace_back("c");
+        EXPECT_EQ(tracked::live, 3);
+        EXPECT_EQ(rb.pop_front().val, "a");
+        EXPECT_EQ(tracked::live, 2);
+        rb.emplace_back("d");
+        rb.emplace_back("e");
+        EXPECT_THROW(rb.emplace_back("f"), std::runtime_error);
+        EXPECT_EQ(tracked::live, 4);
+    }
+    EXPECT_EQ(tracked::live, 0);
+}
+
+TEST(RingBufferShould, OverwriteOldestWhenFull)
+{
+    {
+        si::ring_buffer<tracked, si::overwrite_when_full> rb(3);
+        for (int i = 0; i < 10; ++ i)
+            rb.emplace_back(std::to_string(i));
+        EXPECT_EQ(rb.size(), 3u);
+        EXPECT_EQ(tracked::live, 3);
+
+        EXPECT_EQ(rb.pop_front().val, "7");
+        EXPECT_EQ(rb.pop_front().val, "8");
+        rb.push_back(tracked("10"));
+        EXPECT_EQ(rb.pop_front().val, "9");
+        EXPECT_EQ(rb.pop_front().val, "10");
+        EXPECT_TRUE(rb.empty());
+    }
+    EXPECT_EQ(tracked::live, 0);
+    EXPECT_THROW((si::ring_buffer<int, si::overwrite_when_full>(0)), std::invalid_argument);
+}
+
+TEST(RingBufferShould, GrowWhenFull)
+{
+    {
+        si::ring_buffer<tracked, si::grow_when_full> rb(0);
+        rb.emplace_back("x");
+        // Wrap around before growing
+        for (int i = 0; i < 3; ++ i)
+            rb.emplace_back(std::to_string(i));
+        rb.pop_front();
+        for (int i = 3; i < 10; ++ i)
+            rb.emplace_back(std::to_string(i));
+
+        EXPECT_EQ(rb.size(), 10u);
+        EXPECT_EQ(rb.capacity(), 16u);
+        EXPECT_EQ(tracked::live, 10);
+        for (int i = 0; i < 10; ++ i)
+            EXPECT_EQ(rb.pop_front().val, std::to_string(i));
+    }
+    EXPECT_EQ(tracked::live, 0);
+}
+
+TEST(SpscRingBufferShould, FailWhenFullOrEmpty)
+{
+    si::spsc_ring_buffer<std::string> rb(3);
+    EXPECT_EQ(rb.capacity(), 4u);
+    EXPECT_FALSE(rb.try_pop());
+
+    for (int lap = 0; lap < 3; ++ lap)
+    {
+        for (int i = 0; i < 4; ++ i)
+            EXPECT_TRUE(rb.try_push(std::to_string(i)));
+        EXPECT_FALSE(rb.try_emplace("4"));
+        EXPECT_EQ(rb.size(), 4u);
+
+        std::string val;
+        EXPECT_TRUE(rb.try_pop(val));
+        EXPECT_EQ(val, "0");
+        for (int i = 1; i < 4; ++ i)
+            EXPECT_EQ(*rb.try_pop(), std::to_string(i));
+        EXPECT_TRUE(rb.empty());
+    }
+}
+
+TEST(SpscRingBufferShould, DestroyRemainingValues)
+{
+    auto val = std::make_shared<int>(1);
+    {
+        si::spsc_ring_buffer<std::shared_ptr<int>> rb(4);
+        rb.try_push(val);
+        rb.try_push(val);
+        EXPECT_TRUE(rb.try_pop());
+        EXPECT_EQ(val.use_count(), 2);
+    }
+    EXPECT_EQ(val.use_count(), 1);
+}
+
+TEST(SpscRingBufferShould, HandOffInOrderAcrossThreads)
+{
+    const int num_values = 100000;
+    si::spsc_ring_buffer<int> rb(16);
+
+    std::thread producer([&rb]() {
+        for (int i = 0; i < num_values; ++ i)
+            while (!rb.try_push(i))
+                std::this_thread::yield();
+    });
+
+    int val;
+    for (int i = 0; i < num_values; ++ i)
+    {
+        while (!rb.try_pop(val))
+            std::this_thread::yield();
+        ASSERT_EQ(val, i);
+    }
+    producer.join();
+    EXPECT_TRUE(rb.empty());
+}
+
+TEST(SpscRingBufferShould, ReserveAndCommitInPlace)
+{
+    si::spsc_ring_buffer<int> rb(8);
+    // Move the head and tail close to the end of the storage
+    for (int i = 0; i < 6; ++ i)
+        rb.try_push(i);
+    EXPECT_EQ(rb.peek(6).size(), 6u);
+    rb.consume(6);
+
+    // WHEN
+    auto spans = rb.reserve(5);
+
+    // THEN
+    ASSERT_EQ(spans.size(), 5u);
+    EXPECT_EQ(spans.first.size, 2u);
+    EXPECT_EQ(spans.second.size, 3u);
+    int val = 10;
+    for (int& slot : spans.first)
+        slot = val ++;
+    for (int& slot : spans.second)
+        slot = val ++;
+    EXPECT_TRUE(rb.empty());
+    rb.commit(4);
+    EXPECT_EQ(rb.size(), 4u);
+
+    // Can't reserve more than the free space
+    EXPECT_EQ(rb.reserve(10).size(), 4u);
+
+    auto read = rb.peek(10);
+    ASSERT_EQ(read.size(), 4u);
+    EXPECT_EQ(std::vector<int>(read.first.begin(), read.first.end()), std::vector<int>({10, 11}));
+    EXPECT_EQ(std::vector<int>(read.second.begin(), read.second.end()), std::vector<int>({12, 13}));
+    rb.consume(1);
+    EXPECT_EQ(*rb.try_pop(), 11);
+}
+
+TEST(SpscRingBufferShould, PushAndPopRanges)
+{
+    si::spsc_ring_buffer<int> rb(8);
+    std::vector<int> in(20);
+    for (int i = 0; i < 20; ++ i)
+        in[i] = i;
+
+    EXPECT_EQ(rb.push_range(in.data(), 5), 5u);
+    std::vector<int> out(20);
+    EXPECT_EQ(rb.pop_range(out.data(), 3), 3u);
+    // Wraps around, only 6 fit
+    EXPECT_EQ(rb.push_range(in.data() + 5, 15), 6u);
+    EXPECT_EQ(rb.pop_range(out.data() + 3, 20), 8u);
+    EXPECT_TRUE(std::equal(out.begin(), out.begin() + 11, in.begin()));
+    EXPECT_EQ(rb.pop_range(out.data(), 20), 0u);
+}
+
+#ifdef __linux__
+TEST(SpscRingBufferShould, ReturnContiguousSpansWhenMirrored)
+{
+    // GIVEN
+    si::spsc_ring_buffer<char, si::mirrored_storage> rb(1);
+    const size_t capacity = rb.capacity();
+    EXPECT_EQ(capacity % sysconf(_SC_PAGESIZE), 0u);
+
+    // Move the head and tail close to the end of the storage
+    std::vector<char> filler(capacity - 2, 'x');
+    EXPECT_EQ(rb.push_range(filler.data(), filler.size()), filler.size());
+    rb.consume(rb.peek(capacity).size());
+
+    // WHEN
+    const std::string msg = "wraps around";
+    auto spans = rb.reserve(msg.size());
+    ASSERT_EQ(spans.first.size, msg.size());
+    EXPECT_EQ(spans.second.size, 0u);
+    std::copy(msg.begin(), msg.end(), spans.first.begin());
+    rb.commit(msg.size());
+
+    // THEN
+    auto read = rb.peek(capacity);
+    ASSERT_EQ(read.first.size, msg.size());
+    EXPECT_EQ(std::string(read.first.begin(), read.first.end()), msg);
+    // What was written past the end went to the beginning of the storage
+    EXPECT_EQ(std::string(read.first.data + 2 - capacity, msg.size() - 2), msg.substr(2));
+    EXPECT_EQ(*rb.try_pop(), 'w');
+}
+#endif
@@ -0,0 +1,95 @@
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include <si_seqlock.h>
+
+namespace {
+
+// Not a multiple of 8 bytes on purpose
+struct quote
+{
+    double   bid;
+    double   ask;
+    uint32_t size;
+};
+
+struct price
+{
+    explicit price(int64_t ticks) : ticks(ticks) {}
+
+    int64_t ticks;
+};
+
+}
+
+TEST(SeqlockShould, LoadAndStore)
+{
+    si::seqlock<quote> q({1.0, 2.0, 3});
+    EXPECT_EQ(q.load().ask, 2.0);
+
+    q.store({4.0, 5.0, 6});
+    const quote val = q.load();
+    EXPECT_EQ(val.bid, 4.0);
+    EXPECT_EQ(val.ask, 5.0);
+    EXPECT_EQ(val.size, 6u);
+
+    q.update([](quote& val) { val.size += 1; });
+    EXPECT_EQ(q.load().size, 7u);
+}
+
+TEST(SeqlockShould, HoldTypesWithoutDefaultConstructor)
+{
+    si::seqlock<price> p(price(10));
+    EXPECT_EQ(p.load().ticks, 10);
+
+    p.update([](price& val) { val.ticks *= 2; });
+    EXPECT_EQ(p.load().ticks, 20);
+}
+
+TEST(SeqlockShould, NeverReturnATornValue)
+{
+    si::seqlock<quote> q({0.0, 0.0, 0});
+    std::atomic<bool> stop{false};
+    std::atomic<int> torn{0};
+
+    std::vector<std::thread> readers;
+    for (int i = 0; i < 3; ++ i)
+        readers.emplace_back([&]() {
+            while (!stop)
+            {
+                const quote val = q.load();
+                if (val.bid != val.ask || val.size != static_cast<uint32_t>(val.bid))
+                    ++ torn;
+            }
+        });
+
+    for (uint32_t i = 1; i <= 100000; ++ i)
+        q.store({double(i), double(i), i});
+    stop = true;
+    for (auto& t : readers)
+        t.join();
+
+    EXPECT_EQ(torn, 0);
+    EXPECT_EQ(q.load().size, 100000u);
+}
+
+TEST(SeqlockShould, SerializeWriters)
+{
+    si::seqlock<quote> q({0.0, 0.0, 0});
+    const int num_threads = 4;
+    const int per_thread = 20000;
+
+    std::vector<std::thread> writers;
+    for (int t = 0; t < num_threads; ++ t)
+        writers.emplace_back([&q]() {
+            for (int i = 0; i < per_thread; ++ i)
+                q.update([](quote& val) { ++ val.size; });
+        });
+    for (auto& t : writers)
+        t.join();
+
+    EXPECT_EQ(q.load().size, static_cast<uint32_t>(num_threads * per_thread));
+}
@@ -1,8 +1,13 @@
 #include <gtest/gtest.h>
 
+#include <chrono>
+#include <ctime>
 #include <future>
+#include <mutex>
 #include <stack>
+#include <thread>
 #include <unordered_set>
+#include <vector>
 
 #include <si_spinlock_mutex.h>
 
@@ -75,3 +80,157 @@ TEST (SpinlockAmdShould, LockAndUnlock)
 
     EXPECT_EQ(popped_values.size(), num_elems);
 }
+
+// Each thread increments the counter under the lock
+template <typename Mutex>
+void count_concurrently(Mutex& m)
+{
+    const int num_threads = 4;
+    const int per_thread = 20000;
+    long long counter = 0;
+
+    std::vector<std::thread> threads;
+    for (int t = 0; t < num_threads; ++ t)
+        threads.emplace_back([&m, &counter]() {
+            for (int i = 0; i < per_thread; ++ i)
+            {
+                std::lock_guard<Mutex> guard(m);
+                ++ counter;
+            }
+        });
+    for (auto& t : threads)
+        t.join();
+
+    EXPECT_EQ(counter, num_threads * per_thread);
+}
+
+TEST (TicketLockShould, LockAndUnlock)
+{
+    si::ticket_lock m;
+    EXPECT_TRUE(m.try_lock());
+    EXPECT_FALSE(m.try_lock());
+    m.unlock();
+
+    count_concurrently(m);
+}
+
+TEST (TicketLockShould, ServeInArrivalOrder)
+{
+    si::ticket_lock m;
+    m.lock();
+
+    // Each waiter takes its ticket before the next one starts
+    std::vector<int> order;
+    std::vector<std::thread> waiters;
+    for (int i = 0; i < 3; ++ i)
+    {
+        waiters.emplace_back([&m, &order, i]() {
+            std::lock_guard<si::ticket_lock> guard(m);
+            order.push_back(i);
+        });
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+
+    m.unlock();
+    for (auto& t : waiters)
+        t.join();
+    EXPECT_EQ(order, std::vector<int>({0, 1, 2}));
+}
+
+TEST (McsLockShould, LockAndUnlock)
+{
+    si::mcs_lock m;
+    EXPECT_TRUE(m.try_lock());
+    EXPECT_FALSE(m.try_lock());
+    m.unlock();
+
+    count_concurrently(m);
+}
+
+TEST (McsLockShould, HoldSeveralLocksAndUseCallerNodes)
+{
+    si::mcs_lock a, b;
+    {
+        std::scoped_lock guard(a, b);
+        EXPECT_FALSE(a.try_lock());
+        EXPECT_FALSE(b.try_lock());
+    }
+
+    si::mcs_lock::node n;
+    a.lock(n);
+    auto other = std::async(std::launch::async, [&a]() { return a.try_lock(); });
+    EXPECT_FALSE(other.get());
+    a.unlock(n);
+    EXPECT_TRUE(a.try_lock());
+    a.unlock();
+}
+
+TEST (AdaptiveMutexShould, LockAndUnlock)
+{
+    si::adaptive_mutex m;
+    EXPECT_TRUE(m.try_lock());
+    EXPECT_FALSE(m.try_lock());
+    m.unlock();
+
+    count_concurrently(m);
+}
+
+TEST (AdaptiveMutexShould, SleepWhileTheLockIsHeld)
+{
+    si::adaptive_mutex m;
+    m.lock();
+
+    // CPU time the waiter used while blocked in lock()
+    auto waiter = std::async(std::launch::async, [&m]() {
+        const std::clock_t start = std::clock();
+        std::lock_guard<si::adaptive_mutex> guard(m);
+        return std::chrono::duration<double, std::milli>(double(std::clock() - start) / CLOCKS_PER_SEC * 1000);
+    });
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    m.unlock();
+    EXPECT_LT(waiter.get().count(), 50.0);
+}
+
+TEST (RwSpinlockShould, ShareBetweenReaders)
+{
+    si::rw_spinlock m;
+    EXPECT_TRUE(m.try_lock_shared());
+    EXPECT_TRUE(m.try_lock_shared());
+    EXPECT_FALSE(m.try_lock());
+    m.unlock_shared();
+    m.unlock_shared();
+
+    EXPECT_TRUE(m.try_lock());
+    EXPECT_FALSE(m.try_lock_shared());
+    EXPECT_FALSE(m.try_lock());
+    m.unlock();
+
+    count_concurrently(m);
+}
+
+TEST (RwSpinlockShould, PreferWaitingWriters)
+{
+    si::rw_spinlock m;
+    m.lock_shared();
+
+    std::atomic<bool> written{false};
+    std::thread writer([&m, &written]() {
+        std::lock_guard<si::rw_spinlock> guard(m);
+        written = true;
+    });
+
+    // New readers are kept out once the writer waits
+    while (m.try_lock_shared())
+    {
+        m.unlock_shared();
+        std::this_thread::yield();
+    }
+    EXPECT_FALSE(written);
+
+    m.unlock_shared();
+    writer.join();
+    EXPECT_TRUE(written);
+    EXPECT_TRUE(m.try_lock_shared());
+    m.unlock_shared();
+}
@@ -1,8 +1,16 @@
 #include <gtest/gtest.h>
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <set>
+#include <stdexcept>
+#include <string>
 #include <thread>
 #include <vector>
 
+#include <si_futex_condition.h>
+#include <si_spinlock_mutex.h>
 #include <si_spmc_queue.h>
 
 
@@ -41,3 +49,110 @@ TEST(spmc_fifo_queue, produce_and_consume)
         consumers[i].join();
 }
 
+
+TEST(spmc_fifo_queue, bounded_push_and_close)
+{
+    si::spmc_fifo_queue<int> q(1);
+    EXPECT_TRUE(q.try_push(1));
+    EXPECT_FALSE(q.try_push(2));
+    EXPECT_FALSE(q.pop_for(std::chrono::milliseconds(0)) == std::nullopt);
+    EXPECT_EQ(q.pop_for(std::chrono::milliseconds(1)), std::nullopt);
+
+    std::thread consumer([&q]() { EXPECT_THROW(q.pop(), std::runtime_error); });
+    // give the consumer some time to block
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    q.close();
+    consumer.join();
+
+    EXPECT_THROW(q.push(3), std::runtime_error);
+}
+
+
+#ifdef __linux__
+TEST(spmc_fifo_queue, other_lock_and_condition)
+{
+    si::spmc_fifo_queue<int, si::adaptive_mutex, si::futex_condition> q(4);
+    EXPECT_EQ(q.pop_for(std::chrono::milliseconds(1)), std::nullopt);
+
+    std::vector<std::thread> consumers;
+    std::atomic<long long> sum{0};
+    for (int i = 0; i < 3; ++i)
+        consumers.emplace_back([&q, &sum]() {
+            try { for (;;) sum += q.pop(); }
+            catch (const std::runtime_error&) {}
+        });
+    for (int i = 0; i < 1000; ++i)
+        q.push(i);
+    q.close();
+    for (auto& t : consumers)
+        t.join();
+    EXPECT_EQ(sum, 999 * 1000 / 2);
+}
+#endif
+
+
+TEST(lockfree_spmc_queue, bounded_push_and_close)
+{
+    si::lockfree_spmc_queue<std::string> q(2);
+    EXPECT_EQ(q.capacity(), 2u);
+    EXPECT_TRUE(q.empty());
+    EXPECT_TRUE(q.try_push("a"));
+    q.push(2, 'b');
+    EXPECT_FALSE(q.try_push("c"));
+
+    std::string val;
+    EXPECT_TRUE(q.try_pop(val));
+    EXPECT_EQ(val, "a");
+    EXPECT_EQ(q.pop(), "bb");
+    EXPECT_FALSE(q.try_pop(val));
+
+    // Parks, then wakes up on push
+    std::thread consumer([&q]() {
+        EXPECT_EQ(q.pop(), "d");
+        EXPECT_THROW(q.pop(), std::runtime_error);
+    });
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    q.push("d");
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    q.close();
+    consumer.join();
+
+    EXPECT_THROW(q.push("e"), std::runtime_error);
+    EXPECT_FALSE(q.try_push("e"));
+}
+
+
+TEST(lockfree_spmc_queue, produce_and_consume)
+{
+    const unsigned num_consumers = 8;
+    const int num_values = 100000;
+    si::lockfree_spmc_queue<int> q(16);
+
+    // Each value is popped exactly once, in order within each consumer.
+    std::vector<std::vector<int>> popped(num_consumers);
+    std::vector<std::thread> consumers;
+    for (unsigned c = 0; c < num_consumers; ++c)
+        consumers.emplace_back([&q, &popped, c]() {
+            try
+            {
+                for (;;)
+                    popped[c].push_back(q.pop());
+            }
+            catch (const std::runtime_error&)
+            {}
+        });
+
+    for (int i = 0; i < num_values; ++i)
+        q.push(i);
+    q.close();
+
+    std::set<int> s;
+    for (unsigned c = 0; c < num_consumers; ++c)
+    {
+        consumers[c].join();
+        EXPECT_TRUE(std::is_sorted(popped[c].begin(), popped[c].end()));
+        s.insert(popped[c].begin(), popped[c].end());
+    }
+    EXPECT_EQ(s.size(), static_cast<size_t>(num_values));
+    EXPECT_TRUE(q.empty());
+}
@@ -0,0 +1,41 @@
+#include <gtest/gtest.h>
+
+#include <atomic>
+
+#include <si_tagged_ptr.h>
+
+TEST(TaggedPtrShould, PackPointerAndTag)
+{
+    int val = 42;
+    si::tagged_ptr<int> p(&val, 7);
+    EXPECT_EQ(p.get(), &val);
+    EXPECT_EQ(p.tag(), 7);
+    EXPECT_EQ(*p.get(), 42);
+    EXPECT_TRUE(p);
+
+    si::tagged_ptr<int> empty;
+    EXPECT_FALSE(empty);
+    EXPECT_EQ(empty.tag(), 0);
+}
+
+TEST(TaggedPtrShould, CompareTags)
+{
+    int val = 42;
+    EXPECT_EQ(si::tagged_ptr<int>(&val, 1), si::tagged_ptr<int>(&val, 1));
+    EXPECT_NE(si::tagged_ptr<int>(&val, 1), si::tagged_ptr<int>(&val, 2));
+}
+
+TEST(TaggedPtrShould, WrapAroundTag)
+{
+    int val = 42;
+    si::tagged_ptr<int> p(&val, 0xFFFF);
+    si::tagged_ptr<int> next(p.get(), p.tag() + 1);
+    EXPECT_EQ(next.get(), &val);
+    EXPECT_EQ(next.tag(), 0);
+}
+
+TEST(TaggedPtrShould, FitInALockFreeAtomic)
+{
+    EXPECT_EQ(sizeof(si::tagged_ptr<int>), sizeof(void*));
+    EXPECT_TRUE(std::atomic<si::tagged_ptr<int>>().is_lock_free());
+}
@@ -0,0 +1,111 @@
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <future>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <si_thread_pool.h>
+
+TEST(ThreadPoolShould, ReturnResultsThroughFutures)
+{
+    si::thread_pool pool(4);
+    EXPECT_EQ(pool.size(), 4u);
+
+    std::vector<std::future<int>> results;
+    for (int i = 0; i < 100; ++ i)
+        results.push_back(pool.submit([i]() { return i * i; }));
+    for (int i = 0; i < 100; ++ i)
+        EXPECT_EQ(results[i].get(), i * i);
+
+    // Move-only callables and results
+    auto ptr = std::make_unique<std::string>("abc");
+    auto moved = pool.submit([p = std::move(ptr)]() { return std::make_unique<std::string>(*p); });
+    EXPECT_EQ(*moved.get(), "abc");
+
+    auto failed = pool.submit([]() { throw std::runtime_error("task failed"); });
+    EXPECT_THROW(failed.get(), std::runtime_error);
+}
+
+TEST(ThreadPoolShould, RunPostedTasksBeforeDestruction)
+{
+    std::atomic<int> count{0};
+    {
+        si::thread_pool pool(2);
+        for (int i = 0; i < 1000; ++ i)
+            pool.post([&count]() { ++ count; });
+    }
+    EXPECT_EQ(count, 1000);
+}
+
+TEST(ThreadPoolShould, SpreadRecursiveTasks)
+{
+    si::thread_pool pool(4);
+    std::atomic<int> count{0};
+    std::promise<void> done;
+
+    // Each task spawns two more from inside a worker, down to depth 12.
+    struct spawner
+    {
+        si::thread_pool& pool;
+        std::atomic<int>& count;
+        std::promise<void>& done;
+
+        void operator()(int depth) const
+        {
+            if (depth < 12)
+            {
+                const spawner self = *this;
+                pool.post([self, depth]() { self(depth + 1); });
+                pool.post([self, depth]() { self(depth + 1); });
+            }
+            if (++ count == (1 << 13) - 1)
+                done.set_value();
+        }
+    };
+    const spawner root{pool, count, done};
+    pool.post([root]() { root(0); });
+    done.get_future().wait();
+    EXPECT_EQ(count, (1 << 13) - 1);
+}
+
+TEST(ThreadPoolShould, RunParallelForOnEveryIndexOnce)
+{
+    si::thread_pool pool(4);
+    const size_t n = 100000;
+    std::vector<std::atomic<int>> hits(n);
+    pool.parallel_for(0, n, [&hits](size_t i) { ++ hits[i]; });
+    for (size_t i = 0; i < n; ++ i)
+        ASSERT_EQ(hits[i].load(), 1) << i;
+
+    // Empty range and explicit grain
+    pool.parallel_for(5, 5, [](size_t) { FAIL(); });
+    std::atomic<size_t> sum{0};
+    pool.parallel_for(10, 20, [&sum](size_t i) { sum += i; }, 3);
+    EXPECT_EQ(sum, 145u);
+}
+
+TEST(ThreadPoolShould, NestParallelFor)
+{
+    si::thread_pool pool(2);
+    std::atomic<long long> sum{0};
+    pool.parallel_for(0, 64, [&pool, &sum](size_t i) {
+        pool.parallel_for(0, 64, [&sum, i](size_t j) { sum += i * 64 + j; });
+    });
+    EXPECT_EQ(sum, 4096LL * 4095 / 2);
+}
+
+TEST(ThreadPoolShould, RethrowFromParallelFor)
+{
+    si::thread_pool pool(4);
+    EXPECT_THROW(pool.parallel_for(0, 1000, [](size_t i) {
+        if (i == 500)
+            throw std::out_of_range("500");
+    }), std::out_of_range);
+
+    // Still usable
+    EXPECT_EQ(pool.submit([]() { return 1; }).get(), 1);
+}
@@ -2,10 +2,15 @@
 
 #include <chrono>
 #include <future>
+#include <memory>
+#include <stdexcept>
 #include <string>
 #include <thread>
 #include <unordered_set>
+#include <vector>
 
+#include <si_futex_condition.h>
+#include <si_spinlock_mutex.h>
 #include <si_threadsafe_queue.h>
 
 TEST(ThreadsafeQueueShould, SupportEmptyAndPush)
@@ -148,6 +153,117 @@ TEST(ThreadsafeQueueShould, TryPopNotEmptyBySharedPtr)
     EXPECT_EQ(*sptr, val);
 }
 
+TEST(ThreadsafeQueueShould, SupportMoveOnlyTypes)
+{
+    si::threadsafe_queue<std::unique_ptr<int>> q;
+    q.push(std::make_unique<int>(1));
+    q.emplace(new int(2));
+
+    std::unique_ptr<int> val;
+    q.wait_and_pop(val);
+    EXPECT_EQ(*val, 1);
+    EXPECT_TRUE(q.try_pop(val));
+    EXPECT_EQ(*val, 2);
+    EXPECT_FALSE(q.try_pop(val));
+}
+
+TEST(ThreadsafeQueueShould, PushBulkAndPopAll)
+{
+    si::threadsafe_queue<int> q;
+    std::vector<int> out;
+    EXPECT_EQ(q.pop_all(out), 0u);
+
+    const std::vector<int> in = {1, 2, 3};
+    q.push_bulk(in.begin(), in.end());
+    q.push(4);
+
+    out.push_back(0);
+    EXPECT_EQ(q.pop_all(out), 4u);
+    EXPECT_EQ(out, std::vector<int>({0, 1, 2, 3, 4}));
+    EXPECT_TRUE(q.empty());
+}
+
+TEST(ThreadsafeQueueShould, WaitAndPopAll)
+{
+    si::threadsafe_queue<int> q;
+    auto f = std::async(std::launch::async, [&q]() {
+        std::vector<int> out;
+        q.wait_and_pop_all(out);
+        return out;
+    });
+
+    // give the new thread some time to run (make sure it waits)
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    const std::vector<int> in = {1, 2, 3};
+    q.push_bulk(in.begin(), in.end());
+
+    EXPECT_EQ(f.get(), in);
+}
+
+TEST(ThreadsafeQueueShould, BlockPushWhenFull)
+{
+    // GIVEN
+    si::threadsafe_queue<int> q(2);
+    EXPECT_TRUE(q.try_push(1));
+    q.push(2);
+    EXPECT_FALSE(q.try_push(3));
+
+    // WHEN
+    auto f = std::async(std::launch::async, [&q]() { q.push(3); });
+    // give the new thread some time to run (make sure it waits)
+    EXPECT_EQ(f.wait_for(std::chrono::milliseconds(10)), std::future_status::timeout);
+
+    // THEN
+    int val = 0;
+    EXPECT_TRUE(q.try_pop(val));
+    f.get();
+    EXPECT_EQ(q.size(), 2u);
+}
+
+TEST(ThreadsafeQueueShould, TimeOutWaitAndPop)
+{
+    si::threadsafe_queue<int> q;
+    int val = 0;
+    EXPECT_FALSE(q.wait_and_pop_for(val, std::chrono::milliseconds(1)));
+
+    q.push(1);
+    EXPECT_TRUE(q.wait_and_pop_for(val, std::chrono::milliseconds(1)));
+    EXPECT_EQ(val, 1);
+}
+
+TEST(ThreadsafeQueueShould, WakeUpWaitersOnClose)
+{
+    // GIVEN
+    si::threadsafe_queue<int> q(1);
+    q.push(1);
+    auto consumer = std::async(std::launch::async, [&q]() {
+        std::vector<int> vals;
+        int val = 0;
+        while (q.wait_and_pop(val))
+            vals.push_back(val);
+        return vals;
+    });
+    auto producer = std::async(std::launch::async, [&q]() {
+        try { for (int i = 2; ; ++ i) q.push(i); }
+        catch (const std::runtime_error&) {}
+    });
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+
+    // WHEN
+    q.close();
+
+    // THEN
+    producer.get();
+    const auto vals = consumer.get();
+    ASSERT_FALSE(vals.empty());
+    for (size_t i = 0; i < vals.size(); ++ i)
+        EXPECT_EQ(vals[i], static_cast<int>(i) + 1);
+    EXPECT_TRUE(q.empty());
+    EXPECT_FALSE(q.try_push(0));
+    EXPECT_THROW(q.push(0), std::runtime_error);
+    EXPECT_EQ(q.wait_and_pop(), nullptr);
+}
+
 TEST(ThreadsafeQueueShould, BeThreadSafe)
 {
     si::threadsafe_queue<int> q;
@@ -180,7 +296,8 @@ TEST(ThreadsafeQueueShould, BeThreadSafe)
             while (not_empty)
             {
                 not_empty = tq.try_pop(val);
-                vals.insert(val);
+                if (not_empty)
+                    vals.insert(val);
             }
 
             return vals;
@@ -194,3 +311,34 @@ TEST(ThreadsafeQueueShould, BeThreadSafe)
 
     EXPECT_EQ(popped_values.size(), 10);
 }
+
+// A bounded queue that makes both the producer and the consumer wait
+template <typename Queue>
+void pass_through_bounded_queue()
+{
+    Queue q(2);
+    int val = 0;
+    EXPECT_FALSE(q.wait_and_pop_for(val, std::chrono::milliseconds(1)));
+
+    auto consumer = std::async(std::launch::async, [&q]() {
+        long long sum = 0;
+        int val = 0;
+        while (q.wait_and_pop(val))
+            sum += val;
+        return sum;
+    });
+    for (int i = 0; i < 1000; ++ i)
+        q.push(i);
+    q.close();
+    EXPECT_EQ(consumer.get(), 999 * 1000 / 2);
+}
+
+TEST(ThreadsafeQueueShould, TakeOtherLocksAndConditions)
+{
+    pass_through_bounded_queue<si::threadsafe_queue<int, si::spinlock_amd>>();
+#ifdef __linux__
+    pass_through_bounded_queue<si::threadsafe_queue<int, si::spinlock_amd, si::futex_condition>>();
+    pass_through_bounded_queue<si::threadsafe_queue<int, si::adaptive_mutex, si::futex_condition>>();
+    pass_through_bounded_queue<si::threadsafe_queue<int, std::mutex, si::futex_condition>>();
+#endif
+}
@@ -1,10 +1,13 @@
 #include <gtest/gtest.h>
 
 #include <future>
+#include <memory>
 #include <string>
 #include <thread>
 #include <unordered_set>
+#include <vector>
 
+#include <si_spinlock_mutex.h>
 #include <si_threadsafe_stack.h>
 
 TEST(ThreadsafeStackShould, SupportEmptyAndPush)
@@ -52,6 +55,37 @@ TEST(ThreadsafeStackShould, ThrowWhenPopOnEmpty)
     }, std::runtime_error);
 }
 
+TEST(ThreadsafeStackShould, TryPopWithoutThrowing)
+{
+    si::threadsafe_stack<std::string> s;
+    std::string val;
+    EXPECT_FALSE(s.try_pop(val));
+    EXPECT_FALSE(s.try_pop());
+
+    s.push("a");
+    s.emplace(3, 'b');
+    auto opt = s.try_pop();
+    ASSERT_TRUE(opt);
+    EXPECT_EQ(*opt, "bbb");
+    EXPECT_TRUE(s.try_pop(val));
+    EXPECT_EQ(val, "a");
+    EXPECT_TRUE(s.empty());
+}
+
+TEST(ThreadsafeStackShould, SupportMoveOnlyTypes)
+{
+    si::threadsafe_stack<std::unique_ptr<int>> s;
+    s.push(std::make_unique<int>(1));
+    s.emplace(new int(2));
+
+    std::unique_ptr<int> val;
+    EXPECT_TRUE(s.try_pop(val));
+    EXPECT_EQ(*val, 2);
+    auto opt = s.try_pop();
+    ASSERT_TRUE(opt);
+    EXPECT_EQ(**opt, 1);
+}
+
 TEST(ThreadsafeStackShould, BeThreadSafe)
 {
     si::threadsafe_stack<int> s;
@@ -109,3 +143,21 @@ TEST(ThreadsafeStackShould, BeThreadSafe)
 
     EXPECT_EQ(popped_values.size(), 10);
 }
+
+TEST(ThreadsafeStackShould, TakeOtherLocks)
+{
+    si::threadsafe_stack<int, si::spinlock_amd> s;
+    std::vector<std::future<void>> pushers;
+    for (int t = 0; t < 4; ++ t)
+        pushers.push_back(std::async(std::launch::async, [&s, t]() {
+            for (int i = 0; i < 1000; ++ i)
+                s.push(t * 1000 + i);
+        }));
+    for (auto& f : pushers)
+        f.get();
+
+    std::unordered_set<int> popped;
+    while (auto val = s.try_pop())
+        popped.insert(*val);
+    EXPECT_EQ(popped.size(), 4000u);
+}
@@ -6,6 +6,7 @@
 #include <unordered_set>
 #include <vector>
 
+#include <si_spinlock_mutex.h>
 #include <si_threadsafe_unordered_map.h>
 
 // Validate our implementations using the same tests.
@@ -70,3 +71,28 @@ TEST(si_threadsafe_unordered_map, has_thread_safe_insert)
 
     EXPECT_EQ(popped_values.size(), total);
 }
+
+TEST(si_threadsafe_unordered_map, takes_a_bucket_lock)
+{
+    using map_type = si::threadsafe_unordered_map<int, int, std::hash<int>, si::rw_spinlock>;
+    map_type m(16);
+    const int num_threads = 4;
+    const int per_thread = 1000;
+
+    std::vector<std::future<void>> futures;
+    for (int t = 0; t < num_threads; ++ t)
+        futures.push_back(std::async(std::launch::async, [&m, t]() {
+            for (int i = t * per_thread; i < (t + 1) * per_thread; ++ i)
+            {
+                m.insert(i, std::make_shared<int>(i));
+                EXPECT_EQ(*m.find(i), i);
+            }
+        }));
+    for (auto& f : futures)
+        f.get();
+
+    for (int i = 0; i < num_threads * per_thread; ++ i)
+        ASSERT_TRUE(m.find(i));
+    m.erase(0);
+    EXPECT_FALSE(m.find(0));
+}
@@ -0,0 +1,115 @@
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <future>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <si_two_lock_queue.h>
+
+TEST(TwoLockQueueShould, SupportEmptyAndPush)
+{
+    si::two_lock_queue<int> q;
+    EXPECT_TRUE(q.empty());
+
+    q.push(42);
+    EXPECT_FALSE(q.empty());
+}
+
+TEST(TwoLockQueueShould, PopInFifoOrder)
+{
+    si::two_lock_queue<std::string> q;
+    q.push("a");
+    q.emplace(2, 'b');
+    const std::string c("c");
+    q.push(c);
+
+    std::string val;
+    EXPECT_TRUE(q.try_pop(val));
+    EXPECT_EQ(val, "a");
+    auto sptr = q.try_pop();
+    ASSERT_TRUE(sptr);
+    EXPECT_EQ(*sptr, "bb");
+    q.wait_and_pop(val);
+    EXPECT_EQ(val, "c");
+
+    EXPECT_FALSE(q.try_pop(val));
+    EXPECT_FALSE(q.try_pop());
+    EXPECT_TRUE(q.empty());
+}
+
+TEST(TwoLockQueueShould, WaitAndPopEmpty)
+{
+    // GIVEN
+    si::two_lock_queue<std::string> q;
+    auto f = std::async(std::launch::async, [&q]() { return q.wait_and_pop(); });
+
+    // give the new thread some time to run (make sure it waits)
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+
+    // WHEN
+    q.push("test");
+
+    // THEN
+    auto sptr = f.get();
+    ASSERT_TRUE(sptr);
+    EXPECT_EQ(*sptr, "test");
+}
+
+TEST(TwoLockQueueShould, SupportMoveOnlyTypes)
+{
+    si::two_lock_queue<std::unique_ptr<int>> q;
+    q.push(std::make_unique<int>(1));
+    q.emplace(new int(2));
+    // Destroyed with the queue
+    q.emplace(new int(3));
+
+    std::unique_ptr<int> val;
+    q.wait_and_pop(val);
+    EXPECT_EQ(*val, 1);
+    EXPECT_TRUE(q.try_pop(val));
+    EXPECT_EQ(*val, 2);
+}
+
+TEST(TwoLockQueueShould, BeThreadSafe)
+{
+    const int num_threads = 4;
+    const int per_thread = 20000;
+    si::two_lock_queue<int> q;
+
+    std::vector<std::thread> producers;
+    for (int t = 0; t < num_threads; ++ t)
+        producers.emplace_back([&q, t]() {
+            for (int i = 0; i < per_thread; ++ i)
+                q.push(t * per_thread + i);
+        });
+
+    // Each consumer checks that the values of each producer come in order.
+    std::vector<std::future<long long>> consumers;
+    for (int t = 0; t < num_threads; ++ t)
+        consumers.push_back(std::async(std::launch::async, [&q]() {
+            std::vector<int> last(num_threads, -1);
+            long long sum = 0;
+            int val;
+            for (int i = 0; i < per_thread; ++ i)
+            {
+                q.wait_and_pop(val);
+                EXPECT_GT(val, last[val / per_thread]);
+                last[val / per_thread] = val;
+                sum += val;
+            }
+            return sum;
+        }));
+
+    for (auto& p : producers)
+        p.join();
+    long long sum = 0;
+    for (auto& c : consumers)
+        sum += c.get();
+
+    const long long n = num_threads * per_thread;
+    EXPECT_EQ(sum, n * (n - 1) / 2);
+    EXPECT_TRUE(q.empty());
+}
@@ -0,0 +1,79 @@
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include <si_work_stealing_deque.h>
+
+TEST(WorkStealingDequeShould, PopLifoAndStealFifo)
+{
+    si::work_stealing_deque<int> d(4);
+    EXPECT_TRUE(d.empty());
+    EXPECT_FALSE(d.pop());
+    EXPECT_FALSE(d.steal());
+
+    for (int i = 0; i < 4; ++ i)
+        d.push(i);
+    EXPECT_EQ(d.size(), 4u);
+
+    EXPECT_EQ(d.steal(), 0);
+    EXPECT_EQ(d.pop(), 3);
+    EXPECT_EQ(d.steal(), 1);
+    EXPECT_EQ(d.pop(), 2);
+    EXPECT_FALSE(d.pop());
+    EXPECT_TRUE(d.empty());
+}
+
+TEST(WorkStealingDequeShould, GrowWhenFull)
+{
+    si::work_stealing_deque<int> d(2);
+    // Wrap around before growing
+    d.push(-1);
+    EXPECT_EQ(d.steal(), -1);
+
+    for (int i = 0; i < 100; ++ i)
+        d.push(i);
+    EXPECT_GE(d.capacity(), 100u);
+
+    for (int i = 0; i < 50; ++ i)
+        EXPECT_EQ(d.steal(), i);
+    for (int i = 99; i >= 50; -- i)
+        EXPECT_EQ(d.pop(), i);
+    EXPECT_TRUE(d.empty());
+}
+
+TEST(WorkStealingDequeShould, HandOutEachElementOnce)
+{
+    const int num_thieves = 4;
+    const int num_values = 200000;
+    si::work_stealing_deque<int> d(8);
+
+    std::vector<std::atomic<int>> taken(num_values);
+    std::atomic<bool> done{false};
+    std::vector<std::thread> thieves;
+    for (int t = 0; t < num_thieves; ++ t)
+        thieves.emplace_back([&]() {
+            while (!done.load() || !d.empty())
+                if (auto v = d.steal())
+                    ++ taken[*v];
+                else
+                    std::this_thread::yield();
+        });
+
+    // The owner pops every other push, so it races the thieves for the
+    // last element all the time, and the deque grows along the way.
+    for (int i = 0; i < num_values; ++ i)
+    {
+        d.push(i);
+        if (i % 2 == 0)
+            if (auto v = d.pop())
+                ++ taken[*v];
+    }
+    done = true;
+
+    for (auto& t : thieves)
+        t.join();
+    for (int i = 0; i < num_values; ++ i)
+        ASSERT_EQ(taken[i].load(), 1) << i;
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <si_broadcast_ring.h>
+
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+// One producer publishes num_events to num_consumers that each read all of them.
+// Returns the number of events per second delivered to each consumer.
+template <typename WaitStrategy>
+double broadcast_ring_fanout_run(unsigned num_consumers)
+{
+    using namespace std::chrono;
+    const long long num_events = 2000000;
+    si::broadcast_ring<long long, WaitStrategy> ring(4096, num_consumers);
+
+    std::vector<std::thread> consumers;
+    std::vector<long long> sums(num_consumers, 0);
+    const auto start = steady_clock::now();
+    for (unsigned c = 0; c < num_consumers; ++ c)
+        consumers.emplace_back([&ring, &sums, c, num_events]() {
+            long long seen = 0, sum = 0;
+            while (seen < num_events)
+                seen += ring.consume(c, [&sum](long long v) { sum += v; });
+            sums[c] = sum;
+        });
+
+    for (long long i = 0; i < num_events; ++ i)
+        ring.publish(i);
+    for (auto& c : consumers)
+        c.join();
+    const double secs = duration_cast<duration<double>>(steady_clock::now() - start).count();
+
+    for (long long sum : sums)
+        if (sum != num_events * (num_events - 1) / 2)
+            std::cout << "wrong sum " << sum << std::endl;
+    return num_events / secs;
+}
+
+// Compares the broadcast_ring wait strategies for 1-16 consumers.
+// Busy spinning is skipped when there aren't enough cores for every thread.
+void broadcast_ring_fanout()
+{
+    const unsigned cores = std::thread::hardware_concurrency();
+    std::cout << "consumers  busy_spin (ev/s)  yielding (ev/s)  blocking (ev/s)" << std::endl;
+    for (unsigned n = 1; n <= 16; n *= 2)
+    {
+        const std::string spin = n + 1 <= cores
+            ? std::to_string(static_cast<long long>(broadcast_ring_fanout_run<si::busy_spin_wait>(n)))
+            : std::string("skipped");
+        const double yielding = broadcast_ring_fanout_run<si::yielding_wait>(n);
+        const double blocking = broadcast_ring_fanout_run<si::blocking_wait>(n);
+
+        std::cout << std::setw(9) << n << std::setw(18) << spin
+                  << std::setw(17) << static_cast<long long>(yielding)
+                  << std::setw(17) << static_cast<long long>(blocking) << std::endl;
+    }
+}
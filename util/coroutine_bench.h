@@ -0,0 +1,112 @@
+#pragma once
+
+#include "measure.h"
+
+#include <si_coroutine.h>
+#include <si_thread_pool.h>
+#include <si_threadsafe_queue.h>
+
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+#include <sys/wait.h>
+#include <unistd.h>
+
+// num_consumers wait on the same threadsafe_queue until one value each is
+// pushed. Reports the memory taken by the waiting consumers and how fast the
+// values get through once they are all waiting.
+// Each configuration runs in a child process to measure its own memory.
+template <typename Start>
+void waiting_consumers_run(const std::string& name, unsigned num_consumers, Start start_consumers)
+{
+    std::cout.flush();
+    if (fork() == 0)
+    {
+        using namespace std::chrono;
+        si::threadsafe_queue<int> q;
+        std::atomic<unsigned> started{0};
+        std::atomic<unsigned> done{0};
+        std::atomic<long long> sum{0};
+
+        const size_t rss_before = resident_memory_kb();
+        const unsigned num_started = start_consumers(q, num_consumers, started, done, sum);
+        while (started != num_started)
+            std::this_thread::yield();
+        // Give the last ones time to suspend
+        std::this_thread::sleep_for(milliseconds(100));
+        const size_t rss = resident_memory_kb() - rss_before;
+
+        const auto start = steady_clock::now();
+        for (unsigned i = 0; i < num_started; ++ i)
+            q.push(1);
+        while (done != num_started)
+            std::this_thread::yield();
+        const double secs = duration_cast<duration<double>>(steady_clock::now() - start).count();
+
+        std::cout << name << "; consumers = " << num_started;
+        if (num_started < num_consumers)
+            std::cout << " (of " << num_consumers << ")";
+        std::cout << "; rss while waiting = " << rss << " KB ("
+                  << (num_started ? rss * 1024.0 / num_started : 0) << " B/consumer)"
+                  << "; Kmsgs/s = " << num_started / secs / 1E3 << std::endl;
+        // Skip the destructors, the threads of the thread version are still there
+        _exit(sum == num_started ? 0 : 1);
+    }
+
+    int status;
+    wait(&status);
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != 0)
+        std::cout << name << " failed" << std::endl;
+}
+
+// Compares consumers that are coroutines suspended in async_pop, resumed on a
+// pool of 4 threads, with a thread per consumer blocked in wait_and_pop.
+// The thread version stops at the first thread that can't be created.
+void coroutine_waiting_consumers()
+{
+    const unsigned pool_threads = 4;
+    for (unsigned num_consumers : {1000u, 10000u, 100000u})
+    {
+        waiting_consumers_run("coroutines", num_consumers,
+            [pool_threads](si::threadsafe_queue<int>& q, unsigned n, std::atomic<unsigned>& started,
+                           std::atomic<unsigned>& done, std::atomic<long long>& sum) {
+                // Leaked on purpose, see _exit above
+                auto* pool = new si::thread_pool(pool_threads);
+                auto consumer = [](si::threadsafe_queue<int>& q, si::thread_pool& pool, std::atomic<unsigned>& started,
+                                   std::atomic<unsigned>& done, std::atomic<long long>& sum) -> si::task<void> {
+                    ++ started;
+                    if (std::optional<int> val = co_await q.async_pop(pool))
+                        sum += *val;
+                    ++ done;
+                };
+                for (unsigned i = 0; i < n; ++ i)
+                    si::spawn(*pool, consumer(q, *pool, started, done, sum));
+                return n;
+            });
+
+        waiting_consumers_run("threads   ", num_consumers,
+            [](si::threadsafe_queue<int>& q, unsigned n, std::atomic<unsigned>& started,
+               std::atomic<unsigned>& done, std::atomic<long long>& sum) {
+                auto* threads = new std::vector<std::thread>();
+                try
+                {
+                    for (unsigned i = 0; i < n; ++ i)
+                        threads->emplace_back([&]() {
+                            ++ started;
+                            int val;
+                            if (q.wait_and_pop(val))
+                                sum += val;
+                            ++ done;
+                        });
+                }
+                catch (const std::system_error&)
+                {}
+                return static_cast<unsigned>(threads->size());
+            });
+    }
+}
@@ -0,0 +1,325 @@
+#pragma once
+
+#include <assert.h>
+#include <unistd.h>
+
+// The first-fit si::malloc before the size-class bins, kept to compare with:
+// a single address-ordered free list, so malloc and free walk the free chunks.
+// Fixed so it survives a fragmented heap: split keeps the space it can't split
+// off in the allocated chunk, update_chunk_P_bit can clear the P bit, and free
+// links the chunk it releases into the list exactly once.
+namespace first_fit {
+
+#define FF_CHUNK_SIZE_T    size_t
+#define FF_CHUNK_ADDR_T    void *
+#define FF_MIN_ALLOC_SIZE  (sizeof(FF_CHUNK_SIZE_T) + sizeof(FF_CHUNK_ADDR_T *))
+#define FF_SBRK_ALLOC_SIZE (4096 * 16)
+#define FF_MIN_ALIGNMENT   8
+#define FF_CONTROL_MASK    0x07
+
+// Pointer to the address of the first free chunk
+static FF_CHUNK_ADDR_T first_free_chunk = NULL;
+
+// Ensures alignment
+inline size_t next_aligned(size_t size)
+{
+    return size + ((FF_MIN_ALIGNMENT - (size & FF_CONTROL_MASK)) & FF_CONTROL_MASK);
+}
+
+// Returns a pointer to the address of the next available free chunk
+inline FF_CHUNK_ADDR_T* next_free(FF_CHUNK_ADDR_T free_chunk)
+{
+    return (FF_CHUNK_ADDR_T*)(static_cast<char*>(free_chunk) + sizeof(FF_CHUNK_SIZE_T));
+}
+
+inline FF_CHUNK_SIZE_T get_size_from_beginning(FF_CHUNK_ADDR_T free_chunk)
+{
+    return *(static_cast<FF_CHUNK_SIZE_T *>(free_chunk));
+}
+
+// Assumes the previous chunk is a free chunk
+inline FF_CHUNK_SIZE_T get_size_from_prev_end(FF_CHUNK_ADDR_T chunk)
+{
+    FF_CHUNK_ADDR_T prev_size_addr = (FF_CHUNK_ADDR_T)(static_cast<char*>(chunk) - sizeof(FF_CHUNK_SIZE_T));
+    return *(static_cast<FF_CHUNK_SIZE_T *>(prev_size_addr));
+}
+
+// Sets the size of the chunk at the beginning only.
+inline void set_size_at_beginning(FF_CHUNK_ADDR_T chunk, size_t size)
+{
+    *(size_t*)(chunk) = size;
+}
+
+// Sets the size of the free chunk at the beginning and at the end.
+inline void set_size_free_chunk(FF_CHUNK_ADDR_T free_chunk, size_t size)
+{
+    set_size_at_beginning(free_chunk, size);
+    *(size_t*)(static_cast<char*>(free_chunk) + (size & ~FF_CONTROL_MASK) - sizeof(FF_CHUNK_SIZE_T)) = size;
+}
+
+inline void mark_last_free(FF_CHUNK_ADDR_T free_chunk)
+{
+    *next_free(free_chunk) = NULL;
+}
+
+
+// Checks if the previous free chunk ends at the position where the current chunk starts.
+// If so, it means the previous chunk is free and updates the P bit in size of the current chunk.
+inline void update_chunk_P_bit(FF_CHUNK_ADDR_T chunk, FF_CHUNK_SIZE_T p_bit_mask)
+{
+    // First confirm that we are not at the end of the heap
+    FF_CHUNK_ADDR_T const program_break = sbrk(0);
+    assert(chunk <= program_break);
+    if (chunk == program_break)
+        return;
+
+    // Read the size and mask of the current chunk
+    FF_CHUNK_SIZE_T size = get_size_from_beginning(chunk);
+
+    // If the P bit already had the same value, there is nothing to do
+    if ((size & 0x01) == p_bit_mask)
+        return;
+
+    // Update the P bit
+    size = (size & ~0x01) | p_bit_mask;
+
+    if (size & 0x02) // if this is a free chunk
+        set_size_free_chunk(chunk, size);
+    else
+        set_size_at_beginning(chunk, size);
+}
+
+// Checks if the previous free chunk ends at the position where the current chunk starts.
+// If so, it means the previous chunk is free and updates the P bit in the mask of the current chunk.
+inline void update_mask_P_bit(FF_CHUNK_ADDR_T prev_free_chunk, FF_CHUNK_ADDR_T cur_chunk, FF_CHUNK_SIZE_T& cur_mask)
+{
+    if (prev_free_chunk)
+    {
+        const FF_CHUNK_SIZE_T prev_size = get_size_from_beginning(prev_free_chunk) & ~FF_CONTROL_MASK;
+        FF_CHUNK_ADDR_T const prev_end = (FF_CHUNK_ADDR_T const)(static_cast<char*>(prev_free_chunk) + prev_size);
+
+        if (prev_end == cur_chunk)
+            cur_mask |= 0x01;
+    }
+}
+
+// The mask contains the 2 least significant bits C and P
+inline FF_CHUNK_ADDR_T alloc_sbrk(size_t size, size_t mask)
+{
+    // If FF_SBRK_ALLOC_SIZE > size, we only want to create another free chunk from
+    // the extra space if there is enough memory to hold the new free chunk.
+    size_t allocated_size = size;
+    const size_t min_free_chunk_size = FF_MIN_ALLOC_SIZE + sizeof(FF_CHUNK_SIZE_T);
+    if (FF_SBRK_ALLOC_SIZE > size + min_free_chunk_size)
+        allocated_size = FF_SBRK_ALLOC_SIZE;
+
+    void* allocated = sbrk(allocated_size);
+
+    if (allocated == (void*)-1)
+        return NULL;
+
+    // Create a free chunk from the allocated memory
+    set_size_free_chunk(allocated, allocated_size | mask);
+    mark_last_free(allocated);
+
+    return allocated;
+}
+
+// Assumes that cur_chunk has enough space to hold the requested size.
+// Potentially breaks cur_chunk into an allocated chunk and a free chunk.
+//  Adds the free chunk to the free chunk list and returns the address of
+//  the allocated space in the allocated chunk.
+inline void* split(FF_CHUNK_ADDR_T cur_chunk, size_t required_size, FF_CHUNK_ADDR_T prev_free_chunk)
+{
+    // Confirm that we have enough space for the allocated chunk.
+    // The chunk size also includes the overhead.
+    FF_CHUNK_SIZE_T chunk_size = get_size_from_beginning(cur_chunk) & ~FF_CONTROL_MASK;
+    assert(chunk_size >= required_size);
+
+    // Set the size and mask of the allocated chunk.
+    // C will 0 because it's an allocated chunk.
+    FF_CHUNK_SIZE_T allocated_size_mask = 0x00;
+    // To find P, we check if previous free chunk is also the previous chunk.
+    update_mask_P_bit(prev_free_chunk, cur_chunk, allocated_size_mask);
+    // The allocated chunk keeps the remaining space if it can't fit a free chunk
+    const bool can_split = chunk_size - required_size >= FF_MIN_ALLOC_SIZE + sizeof(FF_CHUNK_SIZE_T);
+    set_size_at_beginning(cur_chunk, (can_split ? required_size : chunk_size) | allocated_size_mask);
+
+    // If this was the only free chunk, update first_free_chunk
+    const bool was_first_free_chunk = (cur_chunk == first_free_chunk);
+    if (was_first_free_chunk)
+        first_free_chunk = *next_free(first_free_chunk);
+
+    // The current chunk is not free, so next's P bit will be 0
+    FF_CHUNK_SIZE_T next_P_bit = 0x00;
+    bool updated_prev_free_next = false;
+    if (chunk_size > required_size)
+    {
+        // Try to create a free chunk from the remaining space
+        const size_t remaining_size = chunk_size - required_size;
+        // Try to fit a free chunk, otherwise this space will be wasted
+        if (remaining_size >= FF_MIN_ALLOC_SIZE + sizeof(FF_CHUNK_SIZE_T))
+        {
+            // The next chunk will have a free chunk as the previous chunk
+            next_P_bit = 0x01;
+
+            // Set the size including the overhead of the new free chunk
+            FF_CHUNK_ADDR_T free_chunk = (FF_CHUNK_ADDR_T)(static_cast<char*>(cur_chunk) + required_size);
+            // C will 1 because it's a free chunk.
+            // P will be 0, because the previous chunk is allocated.
+            const FF_CHUNK_SIZE_T free_chunk_size_mask = 0x02;
+            set_size_free_chunk(free_chunk, remaining_size | free_chunk_size_mask);
+
+            // Set the pointer to the next free chunk
+            *next_free(free_chunk) = *next_free(cur_chunk);
+
+            // Update the next pointer of the previous free chunk
+            if (prev_free_chunk != NULL)
+                *next_free(prev_free_chunk) = free_chunk;
+            updated_prev_free_next = true;
+
+            if (was_first_free_chunk)
+                first_free_chunk = free_chunk;
+        }
+    }
+
+    // Update the next pointer of the previous last free chunk if we haven't already
+    if (!updated_prev_free_next && prev_free_chunk != NULL)
+        *next_free(prev_free_chunk) = *next_free(cur_chunk);
+
+    // Update the P pointer of the next chunk
+    FF_CHUNK_ADDR_T next_chunk = (FF_CHUNK_ADDR_T)(static_cast<char*>(cur_chunk) + chunk_size);
+    update_chunk_P_bit(next_chunk, next_P_bit);
+
+    void* user_allocated = (void*)(static_cast<char*>(cur_chunk) + sizeof(FF_CHUNK_SIZE_T));
+    return user_allocated;
+}
+
+inline void* malloc(size_t size)
+{
+    if (size == 0)
+        return NULL;
+
+    // Ensure we allocate at least the minimum space required to hold a free chunk.
+    // We want all chunks to have be aligned.
+    if (size < FF_MIN_ALLOC_SIZE)
+        size = FF_MIN_ALLOC_SIZE;
+    const size_t required_size = next_aligned(size + sizeof(FF_CHUNK_SIZE_T));
+
+    // If there is no free memory, try to allocate and return if system fails
+    if (! first_free_chunk)
+    {
+        // C is 1 because the new chunk will be free
+        // P is 0 because there are no other free chunks
+        FF_CHUNK_ADDR_T chunk = alloc_sbrk(required_size, 0x02);
+        if (chunk == NULL)
+            return NULL;
+
+        first_free_chunk = chunk;
+    }
+
+    // Find the first free chunk that contains enough memory to fit the request
+    FF_CHUNK_ADDR_T cur_free = first_free_chunk;
+    FF_CHUNK_ADDR_T prev_free = NULL;
+    while ((get_size_from_beginning(cur_free) & ~FF_CONTROL_MASK) < required_size)
+    {
+        prev_free = cur_free;
+        cur_free = *next_free(cur_free);
+
+        // If this is the last chunk, try to allocate memory and return if system fails
+        if (cur_free == NULL)
+        {
+            // C is 1 because the new chunk will be free.
+            FF_CHUNK_SIZE_T mask = 0x02;
+            // To find P (if the previous chunk was free), we check if prev_free is also
+            // the previous chunk (last one, since we are allocating at the end).
+            FF_CHUNK_ADDR_T const program_break = sbrk(0);
+            update_mask_P_bit(prev_free, program_break, mask);
+
+            cur_free = alloc_sbrk(required_size, mask);
+            if (cur_free == NULL)
+                return NULL;
+
+            // Update the next pointer of the previous free chunk
+            *next_free(prev_free) = cur_free;
+            break;
+        }
+    }
+
+    return split(cur_free, required_size, prev_free);
+}
+
+// Undefined behaviour if we call free on a pointer that was not returned
+// with malloc or that was previously freed.
+inline void free(void* ptr)
+{
+    if (!ptr)
+        return;
+
+    // Check if we can coalesce the previous chunk
+    FF_CHUNK_ADDR_T chunk = (FF_CHUNK_ADDR_T)(static_cast<char*>(ptr) - sizeof(FF_CHUNK_SIZE_T));
+    const FF_CHUNK_SIZE_T chunk_size = get_size_from_beginning(chunk);
+
+    FF_CHUNK_ADDR_T coalesced_start = chunk;
+    FF_CHUNK_SIZE_T coalesced_size = chunk_size & ~FF_CONTROL_MASK;
+    if (chunk_size & 0x01)
+    {
+        const FF_CHUNK_SIZE_T prev_size = get_size_from_prev_end(chunk) & ~FF_CONTROL_MASK;
+        coalesced_start = (FF_CHUNK_ADDR_T)(static_cast<char*>(chunk) - prev_size);
+        coalesced_size += prev_size;
+    }
+
+    // Check if we can coalesce the next chunk
+    FF_CHUNK_ADDR_T next_chunk = (FF_CHUNK_ADDR_T)(static_cast<char*>(coalesced_start) + coalesced_size);
+    FF_CHUNK_ADDR_T const program_break = sbrk(0);
+    assert(next_chunk <= program_break);
+
+    FF_CHUNK_ADDR_T coalesced_end = next_chunk;
+    bool coalesced_next = false;
+    if (next_chunk < program_break)
+    {
+        FF_CHUNK_SIZE_T next_size = get_size_from_beginning(next_chunk);
+        if (next_size & 0x02)
+        {
+            // remove the mask
+            next_size = next_size & ~FF_CONTROL_MASK;
+            // update the coalesced end and size
+            coalesced_end = (FF_CHUNK_ADDR_T)(static_cast<char*>(coalesced_end) + next_size);
+            coalesced_size += next_size;
+            coalesced_next = true;
+        }
+    }
+
+    // Update the metadata of the coalesced chunk.
+    // C is 1 because the current chunk is free.
+    // P is 0 because if the previous chunk were free, we would have coalesced it.
+    set_size_free_chunk(coalesced_start, coalesced_size | 0x02);
+
+    // Set the P bit of the next chunk because this is a free chunk
+    update_chunk_P_bit(coalesced_end, 0x01);
+
+    // A coalesced previous chunk is already in the list, it only skips the next one
+    if (coalesced_start != chunk)
+    {
+        if (coalesced_next)
+            *next_free(coalesced_start) = *next_free(next_chunk);
+        return;
+    }
+
+    // Find the free chunks around it, a coalesced next chunk is replaced
+    FF_CHUNK_ADDR_T prev = NULL;
+    FF_CHUNK_ADDR_T cur = first_free_chunk;
+    while (cur && cur < coalesced_start)
+    {
+        prev = cur;
+        cur = *next_free(cur);
+    }
+
+    *next_free(coalesced_start) = coalesced_next ? *next_free(cur) : cur;
+    if (prev)
+        *next_free(prev) = coalesced_start;
+    else
+        first_free_chunk = coalesced_start;
+}
+
+} // namespace first_fit
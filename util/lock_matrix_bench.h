@@ -0,0 +1,97 @@
+#pragma once
+
+#include "threadsafe_queue_bench.h"
+
+#include <si_futex_condition.h>
+#include <si_spinlock_mutex.h>
+#include <si_spmc_queue.h>
+#include <si_threadsafe_queue.h>
+#include <si_threadsafe_stack.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <iostream>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+// One producer and num_consumers consumers, returns Mmsgs/s.
+template <class Queue>
+double spmc_fifo_throughput(unsigned num_consumers, long long num_msgs)
+{
+    using namespace std::chrono;
+    Queue q;
+    const auto start = steady_clock::now();
+    std::vector<std::thread> consumers;
+    for (unsigned t = 0; t < num_consumers; ++ t)
+        consumers.emplace_back([&q]() {
+            try { for (;;) q.pop(); }
+            catch (const std::runtime_error&) {}
+        });
+
+    for (long long i = 0; i < num_msgs; ++ i)
+        q.push(i);
+    q.close();
+    for (auto& t : consumers)
+        t.join();
+    const double secs = duration_cast<duration<double>>(steady_clock::now() - start).count();
+    return num_msgs / secs / 1E6;
+}
+
+// num_threads threads each push and pop per_thread times, returns Mops/s.
+template <class Stack>
+double stack_throughput(unsigned num_threads, long long per_thread)
+{
+    using namespace std::chrono;
+    Stack s;
+    const auto start = steady_clock::now();
+    std::vector<std::thread> threads;
+    for (unsigned t = 0; t < num_threads; ++ t)
+        threads.emplace_back([&s, per_thread]() {
+            long long val;
+            for (long long i = 0; i < per_thread; ++ i)
+            {
+                s.push(i);
+                s.try_pop(val);
+            }
+        });
+    for (auto& t : threads)
+        t.join();
+    const double secs = duration_cast<duration<double>>(steady_clock::now() - start).count();
+    return 2 * per_thread * num_threads / secs / 1E6;
+}
+
+template <class Lock, class Condition>
+void container_lock_run(const std::string& name, unsigned num_threads)
+{
+    const long long total = 2000000;
+    std::cout << name << "; threads = " << num_threads
+              << "; threadsafe_queue Mmsgs/s = "
+              << queue_mpmc_throughput<si::threadsafe_queue<long long, Lock, Condition>>(num_threads, total / num_threads)
+              << "; spmc_fifo_queue Mmsgs/s = "
+              << spmc_fifo_throughput<si::spmc_fifo_queue<long long, Lock, Condition>>(num_threads, total)
+              << "; threadsafe_stack Mops/s = "
+              << stack_throughput<si::threadsafe_stack<long long, Lock>>(num_threads, total / num_threads)
+              << std::endl;
+}
+
+// Runs the locked containers over each lock and wait strategy. threads is the
+// number of producers and of consumers for threadsafe_queue, the number of
+// consumers for spmc_fifo_queue and of pushing and popping threads for the stack.
+void container_lock_matrix()
+{
+    for (unsigned num_threads = 1; num_threads <= 4; num_threads *= 2)
+    {
+        container_lock_run<std::mutex, std::condition_variable>            ("std::mutex     + condition_variable    ", num_threads);
+#ifdef __linux__
+        container_lock_run<std::mutex, si::futex_condition>                ("std::mutex     + futex_condition       ", num_threads);
+#endif
+        container_lock_run<si::spinlock_amd, std::condition_variable_any>  ("spinlock_amd   + condition_variable_any", num_threads);
+#ifdef __linux__
+        container_lock_run<si::spinlock_amd, si::futex_condition>          ("spinlock_amd   + futex_condition       ", num_threads);
+        container_lock_run<si::adaptive_mutex, si::futex_condition>        ("adaptive_mutex + futex_condition       ", num_threads);
+#endif
+    }
+}
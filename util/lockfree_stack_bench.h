@@ -0,0 +1,195 @@
+#pragma once
+
+#include "measure.h"
+
+#include <si_lockfree_stack.h>
+
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+// Runs 10^9 push/pop pairs over all cores and samples the resident memory
+// to check that popped nodes are reclaimed (memory stays flat).
+void lockfree_stack_memory_growth()
+{
+    using namespace std::chrono;
+    const long long total_pairs = 1000000000LL;
+    const unsigned num_threads = std::max(2u, std::thread::hardware_concurrency());
+    const long long per_thread = total_pairs / num_threads;
+
+    si::lockfree_stack<long long> s;
+    std::atomic<long long> done{0};
+    std::atomic<bool> finished{false};
+
+    std::vector<std::thread> threads;
+    const auto start = steady_clock::now();
+    for (unsigned t = 0; t < num_threads; ++ t)
+        threads.emplace_back([&]() {
+            for (long long i = 0; i < per_thread; ++ i)
+            {
+                s.push(i);
+                s.pop();
+                if ((i & 0xFFFFF) == 0)
+                    done.fetch_add(0x100000, std::memory_order_relaxed);
+            }
+        });
+
+    // Sample the memory while the workers are running
+    std::thread monitor([&]() {
+        size_t peak_kb = 0;
+        while (!finished)
+        {
+            const size_t kb = resident_memory_kb();
+            if (kb > peak_kb)
+            {
+                peak_kb = kb;
+                std::cout << "pairs = " << done << "; rss = " << kb << " KB (new peak)" << std::endl;
+            }
+            std::this_thread::sleep_for(milliseconds(500));
+        }
+    });
+
+    for (auto& t : threads)
+        t.join();
+    const double secs = duration_cast<duration<double>>(steady_clock::now() - start).count();
+    finished = true;
+    monitor.join();
+
+    std::cout << "threads = " << num_threads
+              << "; pairs = " << per_thread * num_threads
+              << "; Mpairs/s = " << per_thread * num_threads / secs / 1E6
+              << "; reclaimed nodes = " << si::epoch_domain::instance().reclaimed()
+              << "; final rss = " << resident_memory_kb() << " KB" << std::endl;
+}
+
+// Runs push/pop pairs on num_threads threads and returns Mpairs/s.
+template <class Stack>
+double stack_throughput(Stack& s, unsigned num_threads, long long pairs_per_thread)
+{
+    using namespace std::chrono;
+    std::vector<std::thread> threads;
+    const auto start = steady_clock::now();
+    for (unsigned t = 0; t < num_threads; ++ t)
+        threads.emplace_back([&s, pairs_per_thread]() {
+            for (long long i = 0; i < pairs_per_thread; ++ i)
+            {
+                s.push(i);
+                s.pop();
+            }
+        });
+
+    for (auto& t : threads)
+        t.join();
+    const double secs = duration_cast<duration<double>>(steady_clock::now() - start).count();
+    return pairs_per_thread * num_threads / secs / 1E6;
+}
+
+// Each configuration runs in a child process so that the peak memory
+// of one doesn't hide the peak memory of the next.
+template <class Reclaimer>
+void reclamation_run(const std::string& name, unsigned num_threads)
+{
+    std::cout.flush();
+    if (fork() == 0)
+    {
+        si::lockfree_stack<long long, Reclaimer> s;
+        const double mpairs = stack_throughput(s, num_threads, 2000000 / num_threads);
+
+        rusage usage;
+        getrusage(RUSAGE_SELF, &usage);
+        std::cout << name << "; threads = " << num_threads
+                  << "; Mpairs/s = " << mpairs
+                  << "; peak rss = " << usage.ru_maxrss << " KB" << std::endl;
+        _exit(0);
+    }
+
+    int status;
+    wait(&status);
+}
+
+// Compares throughput and peak memory of the reclamation policies.
+void lockfree_stack_reclamation()
+{
+    for (unsigned num_threads = 1; num_threads <= 32; num_threads *= 2)
+    {
+        reclamation_run<si::leak_reclamation>          ("leak          ", num_threads);
+        reclamation_run<si::epoch_reclamation>         ("epoch         ", num_threads);
+        reclamation_run<si::hazard_pointer_reclamation>("hazard pointer", num_threads);
+    }
+}
+
+// Measures push/try_pop throughput in steady state (the stack never gets empty)
+// and counts the allocations made during the measured loop.
+template <class Reclaimer>
+void allocation_free_run(const std::string& name, unsigned num_threads)
+{
+    using namespace std::chrono;
+    const long long pairs_per_thread = 4000000 / num_threads;
+    si::lockfree_stack<long long, Reclaimer> s;
+
+    // Warm up: grow the pool to the peak number of live nodes
+    for (unsigned i = 0; i < num_threads; ++ i)
+        s.push(i);
+    long long val;
+    for (unsigned i = 0; i < num_threads; ++ i)
+        s.try_pop(val);
+
+    std::atomic<size_t> allocations{0};
+    std::vector<std::thread> threads;
+    const auto start = steady_clock::now();
+    for (unsigned t = 0; t < num_threads; ++ t)
+        threads.emplace_back([&s, &allocations, pairs_per_thread]() {
+            const size_t before = t_allocations;
+            long long out;
+            for (long long i = 0; i < pairs_per_thread; ++ i)
+            {
+                s.push(i);
+                s.try_pop(out);
+            }
+            allocations += t_allocations - before;
+        });
+
+    for (auto& t : threads)
+        t.join();
+    const double secs = duration_cast<duration<double>>(steady_clock::now() - start).count();
+
+    std::cout << name << "; threads = " << num_threads
+              << "; Mpairs/s = " << pairs_per_thread * num_threads / secs / 1E6
+              << "; allocations = " << allocations << std::endl;
+}
+
+// Shows that the freelist policy pushes and pops without allocating.
+void lockfree_stack_allocation_free()
+{
+    for (unsigned num_threads = 1; num_threads <= 8; num_threads *= 2)
+    {
+        allocation_free_run<si::epoch_reclamation>   ("epoch   ", num_threads);
+        allocation_free_run<si::freelist_reclamation>("freelist", num_threads);
+    }
+}
+
+// Symmetric push/pop load on 1 to 64 threads, with and without elimination.
+void lockfree_stack_elimination()
+{
+    for (unsigned num_threads = 1; num_threads <= 64; num_threads *= 2)
+    {
+        const long long pairs_per_thread = 4000000 / num_threads;
+        {
+            si::lockfree_stack<long long, si::freelist_reclamation> s;
+            std::cout << "no elimination; threads = " << num_threads
+                      << "; Mpairs/s = " << stack_throughput(s, num_threads, pairs_per_thread) << std::endl;
+        }
+        {
+            si::lockfree_stack<long long, si::freelist_reclamation, 16> s;
+            std::cout << "elimination   ; threads = " << num_threads
+                      << "; Mpairs/s = " << stack_throughput(s, num_threads, pairs_per_thread) << std::endl;
+        }
+    }
+}
@@ -1,8 +1,24 @@
 #include "measure.h"
+#include "lockfree_stack_bench.h"
+#include "threadsafe_queue_bench.h"
+#include "mpmc_queue_bench.h"
+#include "spmc_queue_bench.h"
+#include "ring_buffer_bench.h"
+#include "broadcast_ring_bench.h"
+#include "work_stealing_bench.h"
+#include "thread_pool_bench.h"
+#include "coroutine_bench.h"
+#include "spinlock_bench.h"
+#include "rw_lock_bench.h"
+#include "profiled_lock_bench.h"
+#include "lock_matrix_bench.h"
+#include "malloc_bench.h"
 
 #include <numeric>
 #include <iostream>
 #include <list>
+#include <map>
+#include <string>
 #include <vector>
 
 // Compare the performance of std::vector vs std::list
@@ -32,9 +48,56 @@ void vector_vs_list()
     std::cout << "tv = " << tv << "; tl = " << tl << std::endl;
 }
 
-int main()
+int main(int argc, char* argv[])
 {
-    vector_vs_list();
+    const std::map<std::string, void (*)()> benchmarks = {
+        {"vector_vs_list",                 vector_vs_list},
+        {"lockfree_stack_memory_growth",   lockfree_stack_memory_growth},
+        {"lockfree_stack_reclamation",     lockfree_stack_reclamation},
+        {"lockfree_stack_allocation_free", lockfree_stack_allocation_free},
+        {"lockfree_stack_elimination",     lockfree_stack_elimination},
+        {"threadsafe_queue_batching",      threadsafe_queue_batching},
+        {"two_lock_queue_mpmc",            two_lock_queue_mpmc},
+        {"mpmc_queue_latency",             mpmc_queue_latency},
+        {"threadsafe_queue_overload",      threadsafe_queue_overload},
+        {"spmc_queue_push_cost",           spmc_queue_push_cost},
+        {"spsc_ring_buffer_handoff",       spsc_ring_buffer_handoff},
+        {"spsc_ring_buffer_bulk",          spsc_ring_buffer_bulk},
+        {"spsc_ring_buffer_records",       spsc_ring_buffer_records},
+        {"record_ring_buffer_throughput",  record_ring_buffer_throughput},
+        {"ring_buffer_overflow",           ring_buffer_overflow},
+        {"broadcast_ring_fanout",          broadcast_ring_fanout},
+        {"work_stealing_deque_throughput", work_stealing_deque_throughput},
+        {"thread_pool_tiny_tasks",         thread_pool_tiny_tasks},
+        {"coroutine_waiting_consumers",    coroutine_waiting_consumers},
+        {"container_lock_matrix",          container_lock_matrix},
+        {"malloc_fragmented",              malloc_fragmented},
+        {"profiled_lock_overhead",         profiled_lock_overhead},
+        {"rw_lock_read_heavy",             rw_lock_read_heavy},
+        {"spinlock_handoff",               spinlock_handoff},
+    };
+
+    // Run the benchmarks given as arguments, or vector_vs_list when there are none
+    if (argc < 2)
+    {
+        std::cout << "usage: " << argv[0] << " <benchmark>...\navailable:\n";
+        for (const auto& b : benchmarks)
+            std::cout << "  " << b.first << "\n";
+        vector_vs_list();
+    }
+
+    for (int i = 1; i < argc; ++ i)
+    {
+        auto it = benchmarks.find(argv[i]);
+        if (it == benchmarks.end())
+        {
+            std::cout << "unknown benchmark " << argv[i] << std::endl;
+            return 1;
+        }
+
+        std::cout << "== " << it->first << std::endl;
+        it->second();
+    }
 
     return 0;
-}
\ No newline at end of file
+}
@@ -0,0 +1,124 @@
+#pragma once
+
+#include "first_fit_malloc.h"
+
+#include <si_malloc.h>
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <new>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+// Gives the benchmark's own arrays memory that never comes from the brk heap
+// the allocators under test grow with sbrk, and that first_fit walks up to sbrk(0).
+template <typename T>
+struct mmap_allocator
+{
+    using value_type = T;
+
+    mmap_allocator() = default;
+
+    template <typename U>
+    mmap_allocator(const mmap_allocator<U>&) noexcept
+    {}
+
+    T* allocate(size_t n)
+    {
+        void* ptr = mmap(nullptr, n * sizeof(T), PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (ptr == MAP_FAILED)
+            throw std::bad_alloc();
+        return static_cast<T*>(ptr);
+    }
+
+    void deallocate(T* ptr, size_t n) noexcept
+    {
+        munmap(ptr, n * sizeof(T));
+    }
+
+    template <typename U>
+    bool operator== (const mmap_allocator<U>&) const noexcept
+    {
+        return true;
+    }
+};
+
+// Allocates 2 * num_live chunks of random sizes and frees every other one, so
+// num_live free chunks sit between num_live live ones. Then repeatedly frees
+// random live chunks and allocates new ones of random sizes, and reports the
+// average latency of each call.
+// Both allocators use sbrk, so each one runs in a child process with its own heap.
+template <typename Malloc, typename Free>
+void fragmented_heap_run(const std::string& name, size_t num_live, Malloc do_malloc, Free do_free)
+{
+    std::cout.flush();
+    if (fork() == 0)
+    {
+        using namespace std::chrono;
+        const size_t num_rounds = 10;
+        const size_t ops_per_round = 1000;
+
+        std::mt19937 rng(42);
+        std::uniform_int_distribution<size_t> size_dist(8, 1024);
+        std::vector<size_t, mmap_allocator<size_t>> sizes(2 * num_live + num_rounds * ops_per_round);
+        for (size_t& size : sizes)
+            size = size_dist(rng);
+        std::vector<void*, mmap_allocator<void*>> live;
+        live.reserve(2 * num_live);
+
+        for (size_t i = 0; i < 2 * num_live; ++ i)
+            live.push_back(do_malloc(sizes[i]));
+        // Back to front, the first-fit free inserts at the head of its list
+        for (size_t i = num_live; i -- > 0;)
+            do_free(live[2 * i]);
+        for (size_t i = 0; i < num_live; ++ i)
+            live[i] = live[2 * i + 1];
+        live.resize(num_live);
+
+        double malloc_ns = 0, free_ns = 0;
+        size_t next_size = 2 * num_live;
+        std::vector<size_t, mmap_allocator<size_t>> victims(ops_per_round);
+        for (size_t round = 0; round < num_rounds; ++ round)
+        {
+            // Distinct slots, so no chunk is freed twice
+            for (size_t i = 0; i < ops_per_round; ++ i)
+                victims[i] = (round * ops_per_round + i) * 7919 % num_live;
+
+            auto start = steady_clock::now();
+            for (size_t slot : victims)
+                do_free(live[slot]);
+            free_ns += duration_cast<duration<double, std::nano>>(steady_clock::now() - start).count();
+
+            start = steady_clock::now();
+            for (size_t slot : victims)
+                live[slot] = do_malloc(sizes[next_size ++]);
+            malloc_ns += duration_cast<duration<double, std::nano>>(steady_clock::now() - start).count();
+        }
+
+        const size_t num_ops = num_rounds * ops_per_round;
+        std::cout << name << "; live chunks = " << num_live
+                  << "; malloc ns/op = " << malloc_ns / num_ops
+                  << "; free ns/op = " << free_ns / num_ops << std::endl;
+        _exit(0);
+    }
+
+    int status = 0;
+    wait(&status);
+}
+
+// Compares si::malloc, which takes chunks from size-class bins, with the
+// first-fit version it replaced, on a heap with many free chunks.
+void malloc_fragmented()
+{
+    for (size_t num_live : {1000, 10000, 100000})
+    {
+        fragmented_heap_run("first-fit ", num_live, first_fit::malloc, first_fit::free);
+        fragmented_heap_run("size bins ", num_live, si::malloc, si::free);
+    }
+}
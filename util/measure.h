@@ -4,6 +4,11 @@
 #include <numeric>
 #include <array>
 #include <chrono>
+#include <cstddef>
+#include <cstdlib>
+#include <fstream>
+#include <new>
+#include <unistd.h>
 
 // Measures how fast running a function is
 template<typename F>
@@ -34,3 +39,130 @@ double measure(F f)
     std::sort(trials.begin(), trials.end());
     return std::accumulate(trials.begin() + 2, trials.end() - 2, 0.0) / (trials.size() - 4) * 1E6;
 }
+
+// Returns the resident set size of the process in KB (Linux only, 0 otherwise)
+inline size_t resident_memory_kb()
+{
+    size_t total_pages = 0, resident_pages = 0;
+    std::ifstream statm("/proc/self/statm");
+    if (!(statm >> total_pages >> resident_pages))
+        return 0;
+    return resident_pages * (sysconf(_SC_PAGESIZE) / 1024);
+}
+
+// Counts the heap allocations made by the current thread, so that benchmarks
+// can check that a hot path doesn't allocate. Every form of new and delete is
+// replaced, so the allocation and deallocation functions always match.
+inline thread_local size_t t_allocations = 0;
+
+inline void* counted_alloc(size_t size, size_t alignment)
+{
+    ++ t_allocations;
+    size = size ? size : 1;
+    // aligned_alloc wants a multiple of the alignment
+    void* ptr = alignment <= alignof(std::max_align_t)
+        ? std::malloc(size)
+        : std::aligned_alloc(alignment, (size + alignment - 1) / alignment * alignment);
+    if (ptr)
+        return ptr;
+    throw std::bad_alloc();
+}
+
+void* operator new(size_t size)
+{
+    return counted_alloc(size, 0);
+}
+
+void* operator new[](size_t size)
+{
+    return counted_alloc(size, 0);
+}
+
+void* operator new(size_t size, std::align_val_t alignment)
+{
+    return counted_alloc(size, static_cast<size_t>(alignment));
+}
+
+void* operator new[](size_t size, std::align_val_t alignment)
+{
+    return counted_alloc(size, static_cast<size_t>(alignment));
+}
+
+void operator delete(void* ptr) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete[](void* ptr) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete(void* ptr, size_t) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete[](void* ptr, size_t) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete(void* ptr, std::align_val_t) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete[](void* ptr, std::align_val_t) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete(void* ptr, size_t, std::align_val_t) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete[](void* ptr, size_t, std::align_val_t) noexcept
+{
+    std::free(ptr);
+}
+
+// Histogram of latencies in nanoseconds with power of two buckets.
+class latency_histogram
+{
+public:
+    void record(long long ns)
+    {
+        size_t bucket = 0;
+        while (bucket + 1 < d_buckets.size() && (1LL << (bucket + 1)) <= ns)
+            ++ bucket;
+        ++ d_buckets[bucket];
+        ++ d_count;
+        d_max = std::max(d_max, ns);
+    }
+
+    // Upper bound of the bucket that contains the given percentile.
+    long long percentile(double p) const
+    {
+        const size_t rank = static_cast<size_t>(p / 100 * d_count);
+        size_t seen = 0;
+        for (size_t bucket = 0; bucket < d_buckets.size(); ++ bucket)
+        {
+            seen += d_buckets[bucket];
+            if (seen > rank)
+                return std::min(1LL << (bucket + 1), d_max);
+        }
+        return d_max;
+    }
+
+    long long max() const
+    {
+        return d_max;
+    }
+
+private:
+    std::array<size_t, 40> d_buckets{};
+    size_t                 d_count = 0;
+    long long              d_max = 0;
+};
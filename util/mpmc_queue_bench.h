@@ -0,0 +1,71 @@
+#pragma once
+
+#include "measure.h"
+
+#include <si_mpmc_queue.h>
+#include <si_threadsafe_queue.h>
+
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <thread>
+
+// Sends timestamps from one producer to one consumer every interval and
+// records how long each one took to get through the queue.
+// push(ts) and pop() adapt the API of each queue.
+template <typename Push, typename Pop>
+void handoff_latency_run(const std::string& name, Push push, Pop pop)
+{
+    using namespace std::chrono;
+    const long long num_msgs = 200000;
+    const auto interval = microseconds(2);
+
+    latency_histogram hist;
+    std::thread consumer([&hist, &pop, num_msgs]() {
+        for (long long i = 0; i < num_msgs; ++ i)
+        {
+            const long long ts = pop();
+            hist.record(duration_cast<nanoseconds>(steady_clock::now().time_since_epoch()).count() - ts);
+        }
+    });
+
+    auto next = steady_clock::now();
+    for (long long i = 0; i < num_msgs; ++ i)
+    {
+        while (steady_clock::now() < next)
+            std::this_thread::yield();
+        next += interval;
+        push(duration_cast<nanoseconds>(steady_clock::now().time_since_epoch()).count());
+    }
+    consumer.join();
+
+    std::cout << name
+              << "; p50 = " << hist.percentile(50) << " ns"
+              << "; p99 = " << hist.percentile(99) << " ns"
+              << "; p99.9 = " << hist.percentile(99.9) << " ns"
+              << "; max = " << hist.max() << " ns" << std::endl;
+}
+
+// Compares the handoff latency of threadsafe_queue, blocking_mpmc_queue and
+// a consumer spinning on mpmc_queue::try_pop.
+void mpmc_queue_latency()
+{
+    {
+        si::threadsafe_queue<long long> q;
+        handoff_latency_run("threadsafe_queue    ",
+            [&q](long long ts) { q.push(ts); },
+            [&q]() { long long ts = 0; q.wait_and_pop(ts); return ts; });
+    }
+    {
+        si::blocking_mpmc_queue<long long> q(1024);
+        handoff_latency_run("blocking_mpmc_queue ",
+            [&q](long long ts) { q.push(ts); },
+            [&q]() { return q.pop(); });
+    }
+    {
+        si::mpmc_queue<long long> q(1024);
+        handoff_latency_run("mpmc_queue (spin)   ",
+            [&q](long long ts) { while (!q.try_push(ts)) std::this_thread::yield(); },
+            [&q]() { long long ts = 0; while (!q.try_pop(ts)) std::this_thread::yield(); return ts; });
+    }
+}
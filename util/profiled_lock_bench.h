@@ -0,0 +1,60 @@
+#pragma once
+
+#include <si_profiled_lock.h>
+#include <si_spinlock_mutex.h>
+
+#include <chrono>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// num_threads threads each take the lock per_thread times around a tiny
+// critical section. Returns the ns per acquisition.
+template <typename Mutex>
+double profiled_lock_run(Mutex& m, unsigned num_threads)
+{
+    using namespace std::chrono;
+    const long per_thread = (1 << 22) / num_threads;
+    long long shared = 0;
+
+    const auto start = steady_clock::now();
+    std::vector<std::thread> threads;
+    for (unsigned t = 0; t < num_threads; ++ t)
+        threads.emplace_back([&m, &shared, per_thread]() {
+            for (long i = 0; i < per_thread; ++ i)
+            {
+                std::lock_guard<Mutex> guard(m);
+                ++ shared;
+            }
+        });
+    for (auto& t : threads)
+        t.join();
+    return duration_cast<duration<double, std::nano>>(steady_clock::now() - start).count() / shared;
+}
+
+template <typename Mutex>
+void profiled_lock_compare(const std::string& name)
+{
+    for (unsigned num_threads : {1u, 4u})
+    {
+        Mutex plain;
+        si::profiled_lock<Mutex> profiled("bench " + name + " " + std::to_string(num_threads) + " threads");
+        const double plain_ns = profiled_lock_run(plain, num_threads);
+        const double profiled_ns = profiled_lock_run(profiled, num_threads);
+        std::cout << name << "; threads = " << num_threads
+                  << "; plain ns/acquisition = " << plain_ns
+                  << "; profiled ns/acquisition = " << profiled_ns << std::endl;
+    }
+}
+
+// Measures what profiled_lock adds to std::mutex and the spinlocks,
+// uncontended and with 4 threads, then dumps what it recorded.
+void profiled_lock_overhead()
+{
+    profiled_lock_compare<std::mutex>        ("std::mutex    ");
+    profiled_lock_compare<si::spinlock_amd>  ("spinlock_amd  ");
+    profiled_lock_compare<si::adaptive_mutex>("adaptive_mutex");
+    si::lock_registry::instance().dump(std::cout);
+}
@@ -0,0 +1,320 @@
+#pragma once
+
+#include <si_record_ring_buffer.h>
+#include <si_ring_buffer.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#include <pthread.h>
+#include <sched.h>
+
+// Pins the calling thread to the given core, if there is such a core.
+inline void pin_to_core(unsigned core)
+{
+    if (core >= std::thread::hardware_concurrency())
+        return;
+
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(core, &set);
+    pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+}
+
+// Measures the one-way handoff latency between two cores as half the round
+// trip of a value bounced back through a second buffer, and the throughput
+// of streaming values in one direction.
+void spsc_ring_buffer_handoff()
+{
+    using namespace std::chrono;
+    const long long num_round_trips = 1000000;
+    const long long num_values = 50000000;
+    if (std::thread::hardware_concurrency() < 2)
+        std::cout << "only one core, the threads will share it" << std::endl;
+
+    {
+        si::spsc_ring_buffer<long long> ping(1024), pong(1024);
+        std::thread echo([&ping, &pong, num_round_trips]() {
+            pin_to_core(1);
+            long long val;
+            for (long long i = 0; i < num_round_trips; ++ i)
+            {
+                while (!ping.try_pop(val))
+                    std::this_thread::yield();
+                while (!pong.try_push(val))
+                    ;
+            }
+        });
+
+        pin_to_core(0);
+        const auto start = steady_clock::now();
+        long long val;
+        for (long long i = 0; i < num_round_trips; ++ i)
+        {
+            while (!ping.try_push(i))
+                ;
+            while (!pong.try_pop(val))
+                std::this_thread::yield();
+        }
+        const double ns = duration_cast<duration<double, std::nano>>(steady_clock::now() - start).count();
+        echo.join();
+
+        std::cout << "one-way handoff = " << ns / num_round_trips / 2 << " ns" << std::endl;
+    }
+
+    {
+        si::spsc_ring_buffer<long long> rb(1024);
+        const auto start = steady_clock::now();
+        std::thread producer([&rb, num_values]() {
+            pin_to_core(1);
+            for (long long i = 0; i < num_values; ++ i)
+                while (!rb.try_push(i))
+                    std::this_thread::yield();
+        });
+
+        long long val;
+        for (long long i = 0; i < num_values; ++ i)
+            while (!rb.try_pop(val))
+                std::this_thread::yield();
+        producer.join();
+        const double secs = duration_cast<duration<double>>(steady_clock::now() - start).count();
+
+        std::cout << "streaming Mvalues/s = " << num_values / secs / 1E6 << std::endl;
+    }
+}
+
+// Streams values from one thread to another in batches of batch_size,
+// either one element at a time or with push_range/pop_range.
+template <bool Bulk>
+void spsc_bulk_run(size_t batch_size)
+{
+    using namespace std::chrono;
+    const long long num_values = 100000000;
+    si::spsc_ring_buffer<long long> rb(4096);
+
+    const auto start = steady_clock::now();
+    std::thread producer([&rb, batch_size, num_values]() {
+        pin_to_core(1);
+        std::vector<long long> batch(batch_size);
+        for (long long sent = 0; sent < num_values; )
+        {
+            const size_t n = std::min<long long>(batch_size, num_values - sent);
+            for (size_t i = 0; i < n; ++ i)
+                batch[i] = sent + i;
+            for (size_t done = 0; done < n; )
+            {
+                const size_t pushed = Bulk ? rb.push_range(batch.data() + done, n - done)
+                                           : rb.try_push(batch[done]);
+                if (pushed == 0)
+                    std::this_thread::yield();
+                done += pushed;
+            }
+            sent += n;
+        }
+    });
+
+    std::vector<long long> batch(batch_size);
+    long long sum = 0;
+    for (long long received = 0; received < num_values; )
+    {
+        size_t n = 0;
+        if (Bulk)
+            n = rb.pop_range(batch.data(), batch_size);
+        else
+            while (n < batch_size && rb.try_pop(batch[n]))
+                ++ n;
+        if (n == 0)
+            std::this_thread::yield();
+        for (size_t i = 0; i < n; ++ i)
+            sum += batch[i];
+        received += n;
+    }
+    producer.join();
+    const double secs = duration_cast<duration<double>>(steady_clock::now() - start).count();
+
+    std::cout << (Bulk ? "push_range/pop_range" : "try_push/try_pop    ")
+              << "; batch = " << batch_size
+              << "; Mvalues/s = " << num_values / secs / 1E6
+              << "; checksum ok = " << (sum == num_values * (num_values - 1) / 2) << std::endl;
+}
+
+// Compares element by element copies with bulk memcpys.
+void spsc_ring_buffer_bulk()
+{
+    for (size_t batch_size = 8; batch_size <= 512; batch_size *= 4)
+    {
+        spsc_bulk_run<false>(batch_size);
+        spsc_bulk_run<true> (batch_size);
+    }
+}
+
+// Returns a pointer to the n bytes at offset off of spans, copying them to
+// scratch if they are split between the two spans.
+inline const char* contiguous_bytes(const si::ring_spans<char>& spans, size_t off, size_t n, char* scratch)
+{
+    if (off + n <= spans.first.size)
+        return spans.first.data + off;
+    if (off >= spans.first.size)
+        return spans.second.data + (off - spans.first.size);
+
+    const size_t first = spans.first.size - off;
+    std::memcpy(scratch, spans.first.data + off, first);
+    std::memcpy(scratch + first, spans.second.data, n - first);
+    return scratch;
+}
+
+// A producer writes records of 8-256 bytes prefixed by their 2 byte length,
+// the consumer parses them in place and sums their bytes. The buffer is a
+// single page, so records wrap around often.
+template <class Storage>
+void record_parsing_run(const std::string& name)
+{
+    using namespace std::chrono;
+    const long long num_records = 20000000;
+    si::spsc_ring_buffer<char, Storage> rb(4096);
+
+    const auto start = steady_clock::now();
+    std::thread producer([&rb, num_records]() {
+        pin_to_core(1);
+        char record[2 + 256];
+        std::memset(record, 1, sizeof(record));
+        uint32_t rnd = 1;
+        for (long long i = 0; i < num_records; ++ i)
+        {
+            rnd ^= rnd << 13;
+            rnd ^= rnd >> 17;
+            rnd ^= rnd << 5;
+            const uint16_t len = 8 + rnd % 249;
+            std::memcpy(record, &len, sizeof(len));
+            while (rb.reserve(2 + len).size() < 2u + len)
+                std::this_thread::yield();
+            rb.push_range(record, 2 + len);
+        }
+    });
+
+    char scratch[2 + 256];
+    long long parsed = 0, bytes = 0, sum = 0;
+    while (parsed < num_records)
+    {
+        const si::ring_spans<char> spans = rb.peek(rb.capacity());
+        size_t off = 0;
+        for (;;)
+        {
+            uint16_t len;
+            if (spans.size() - off < sizeof(len))
+                break;
+            std::memcpy(&len, contiguous_bytes(spans, off, sizeof(len), scratch), sizeof(len));
+            if (spans.size() - off < sizeof(len) + len)
+                break;
+
+            const char* payload = contiguous_bytes(spans, off + sizeof(len), len, scratch);
+            for (uint16_t i = 0; i < len; ++ i)
+                sum += payload[i];
+            off += sizeof(len) + len;
+            ++ parsed;
+        }
+
+        if (off == 0)
+            std::this_thread::yield();
+        rb.consume(off);
+        bytes += off;
+    }
+    producer.join();
+    const double secs = duration_cast<duration<double>>(steady_clock::now() - start).count();
+
+    std::cout << name
+              << "; Mrecords/s = " << num_records / secs / 1E6
+              << "; MB/s = " << bytes / secs / 1E6
+              << "; checksum ok = " << (sum == bytes - 2 * num_records) << std::endl;
+}
+
+// Compares parsing records in a heap ring buffer, where records that wrap
+// around have to be copied, with a mirrored one, where they never do.
+void spsc_ring_buffer_records()
+{
+    record_parsing_run<si::heap_storage>    ("heap    ");
+    record_parsing_run<si::mirrored_storage>("mirrored");
+}
+
+// Streams messages of msg_size bytes through a 1MB record_ring_buffer.
+void record_throughput_run(size_t msg_size)
+{
+    using namespace std::chrono;
+    const long long num_msgs = 4000000000LL / (msg_size + 64);
+    si::record_ring_buffer<> rb(1 << 20);
+
+    const auto start = steady_clock::now();
+    std::thread producer([&rb, msg_size, num_msgs]() {
+        pin_to_core(1);
+        std::vector<char> msg(msg_size, 1);
+        for (long long i = 0; i < num_msgs; ++ i)
+            while (!rb.try_push(msg.data(), msg.size()))
+                std::this_thread::yield();
+    });
+
+    long long sum = 0;
+    for (long long i = 0; i < num_msgs; ++ i)
+        while (!rb.try_pop([&sum](const char* data, size_t size) { sum += data[0] + data[size - 1]; }))
+            std::this_thread::yield();
+    producer.join();
+    const double secs = duration_cast<duration<double>>(steady_clock::now() - start).count();
+
+    std::cout << "size = " << msg_size
+              << "; Mmsgs/s = " << num_msgs / secs / 1E6
+              << "; GB/s = " << num_msgs * msg_size / secs / 1E9
+              << "; checksum ok = " << (sum == 2 * num_msgs) << std::endl;
+}
+
+// Message sizes from 16B to 4KB.
+void record_ring_buffer_throughput()
+{
+    for (size_t msg_size = 16; msg_size <= 4096; msg_size *= 4)
+        record_throughput_run(msg_size);
+}
+
+// Pushes num_pushes elements into a ring_buffer with the given overflow
+// policy and returns Mpushes/s. With throw_when_full the consumer pops the
+// oldest element first when the buffer is full, with grow_when_full the
+// buffer starts small and grows to hold all the elements.
+template <typename T, typename Overflow>
+double overflow_push_throughput(const T& val, size_t num_pushes)
+{
+    using namespace std::chrono;
+    const bool grows = std::is_same<Overflow, si::grow_when_full>::value;
+    si::ring_buffer<T, Overflow> rb(grows ? 16 : 1024);
+
+    const auto start = steady_clock::now();
+    for (size_t i = 0; i < num_pushes; ++ i)
+    {
+        if (std::is_same<Overflow, si::throw_when_full>::value && rb.size() == rb.capacity())
+            rb.pop_front();
+        rb.push_back(val);
+    }
+    const double secs = duration_cast<duration<double>>(steady_clock::now() - start).count();
+    return num_pushes / secs / 1E6;
+}
+
+template <typename T>
+void overflow_run(const std::string& name, const T& val)
+{
+    const size_t num_pushes = 4000000;
+    std::cout << name
+              << "; throw Mpushes/s = "     << overflow_push_throughput<T, si::throw_when_full>    (val, num_pushes)
+              << "; overwrite Mpushes/s = " << overflow_push_throughput<T, si::overwrite_when_full>(val, num_pushes)
+              << "; grow Mpushes/s = "      << overflow_push_throughput<T, si::grow_when_full>     (val, num_pushes)
+              << std::endl;
+}
+
+// Compares the push throughput of the ring_buffer overflow policies.
+void ring_buffer_overflow()
+{
+    overflow_run("long long  ", 42LL);
+    overflow_run("std::string", std::string(48, 'x'));
+}
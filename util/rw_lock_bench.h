@@ -0,0 +1,144 @@
+#pragma once
+
+#include <si_seqlock.h>
+#include <si_spinlock_mutex.h>
+#include <si_threadsafe_unordered_map.h>
+
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// num_threads threads look up random keys in a threadsafe_unordered_map with
+// the given bucket lock, and one operation in 100 is an update.
+template <typename SharedMutex>
+void rw_lock_map_run(const std::string& name, unsigned num_threads)
+{
+    using namespace std::chrono;
+    const int num_keys = 1024;
+    const long ops_per_thread = (1 << 22) / num_threads;
+
+    si::threadsafe_unordered_map<int, int, std::hash<int>, SharedMutex> m(num_keys / 4);
+    for (int i = 0; i < num_keys; ++ i)
+        m.insert(i, std::make_shared<int>(i));
+    const auto val = std::make_shared<int>(0);
+
+    const auto start = steady_clock::now();
+    std::vector<std::thread> threads;
+    for (unsigned t = 0; t < num_threads; ++ t)
+        threads.emplace_back([&m, &val, t, ops_per_thread]() {
+            unsigned x = t * 2654435761u + 1;
+            for (long i = 0; i < ops_per_thread; ++ i)
+            {
+                x = x * 1103515245u + 12345u;
+                const int key = (x >> 8) % num_keys;
+                if (i % 100 == 0)
+                    m.insert_or_update(key, val);
+                else
+                    m.find(key);
+            }
+        });
+    for (auto& t : threads)
+        t.join();
+    const double secs = duration_cast<duration<double>>(steady_clock::now() - start).count();
+
+    std::cout << name << "; threads = " << num_threads
+              << "; map Mops/s = " << ops_per_thread * num_threads / secs / 1E6 << std::endl;
+}
+
+struct quote
+{
+    double bid;
+    double ask;
+    long   size;
+};
+
+// The same interface as seqlock<quote> on top of a reader-writer lock
+template <typename SharedMutex>
+class locked_quote
+{
+public:
+    quote load() const
+    {
+        std::shared_lock<SharedMutex> slock(d_mutex);
+        return d_quote;
+    }
+
+    void store(const quote& q)
+    {
+        std::lock_guard<SharedMutex> guard(d_mutex);
+        d_quote = q;
+    }
+
+private:
+    quote               d_quote{};
+    mutable SharedMutex d_mutex;
+};
+
+// num_readers threads read a quote for a fixed time while one thread keeps
+// updating it, yielding between updates.
+template <typename Snapshot>
+void rw_lock_snapshot_run(const std::string& name, unsigned num_readers)
+{
+    using namespace std::chrono;
+    Snapshot s;
+    std::atomic<bool> stop{false};
+    std::atomic<long> num_reads{0};
+    long num_writes = 0;
+
+    std::thread writer([&]() {
+        while (!stop.load(std::memory_order_relaxed))
+        {
+            ++ num_writes;
+            s.store({double(num_writes), double(num_writes + 1), num_writes});
+            std::this_thread::yield();
+        }
+    });
+
+    std::vector<std::thread> readers;
+    for (unsigned t = 0; t < num_readers; ++ t)
+        readers.emplace_back([&]() {
+            long reads = 0;
+            double sum = 0;
+            while (!stop.load(std::memory_order_relaxed))
+            {
+                sum += s.load().ask;
+                ++ reads;
+            }
+            num_reads += reads + (sum < 0);
+        });
+
+    std::this_thread::sleep_for(milliseconds(200));
+    stop = true;
+    writer.join();
+    for (auto& t : readers)
+        t.join();
+
+    std::cout << name << "; readers = " << num_readers
+              << "; Mreads/s = " << num_reads / 0.2 / 1E6
+              << "; Kwrites/s = " << num_writes / 0.2 / 1E3 << std::endl;
+}
+
+// Compares std::shared_mutex with rw_spinlock as the bucket lock of
+// threadsafe_unordered_map, and with rw_spinlock and seqlock for a small
+// snapshot, on read-heavy loads with 1-8 threads.
+void rw_lock_read_heavy()
+{
+    for (unsigned num_threads = 1; num_threads <= 8; num_threads *= 2)
+    {
+        rw_lock_map_run<std::shared_mutex>("shared_mutex", num_threads);
+        rw_lock_map_run<si::rw_spinlock>  ("rw_spinlock ", num_threads);
+    }
+
+    for (unsigned num_readers = 1; num_readers <= 8; num_readers *= 2)
+    {
+        rw_lock_snapshot_run<locked_quote<std::shared_mutex>>("shared_mutex", num_readers);
+        rw_lock_snapshot_run<locked_quote<si::rw_spinlock>>  ("rw_spinlock ", num_readers);
+        rw_lock_snapshot_run<si::seqlock<quote>>             ("seqlock     ", num_readers);
+    }
+}
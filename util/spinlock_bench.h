@@ -0,0 +1,71 @@
+#pragma once
+
+#include <si_spinlock_mutex.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// num_threads threads take the lock in a loop for a fixed time, with a tiny
+// critical section. Reports the average time between two acquisitions (the
+// handoff latency under contention) and the fairness: the fewest acquisitions
+// of a thread divided by the most (1 = perfectly fair).
+template <typename Mutex>
+void lock_handoff_run(const std::string& name, unsigned num_threads)
+{
+    using namespace std::chrono;
+    Mutex m;
+    std::atomic<bool> stop{false};
+    long long shared = 0;
+    std::vector<long long> counts(num_threads * 8, 0); // a cache line each
+
+    std::vector<std::thread> threads;
+    for (unsigned t = 0; t < num_threads; ++ t)
+        threads.emplace_back([&, t]() {
+            long long& own = counts[t * 8];
+            while (!stop.load(std::memory_order_relaxed))
+            {
+                std::lock_guard<Mutex> guard(m);
+                ++ shared;
+                ++ own;
+            }
+        });
+
+    const auto start = steady_clock::now();
+    std::this_thread::sleep_for(milliseconds(200));
+    stop = true;
+    for (auto& t : threads)
+        t.join();
+    const double ns = duration_cast<duration<double, std::nano>>(steady_clock::now() - start).count();
+
+    long long min_count = counts[0], max_count = counts[0];
+    for (unsigned t = 1; t < num_threads; ++ t)
+    {
+        min_count = std::min(min_count, counts[t * 8]);
+        max_count = std::max(max_count, counts[t * 8]);
+    }
+
+    std::cout << name << "; threads = " << num_threads
+              << "; ns/acquisition = " << ns / shared
+              << "; fairness = " << (max_count ? double(min_count) / max_count : 0) << std::endl;
+}
+
+// Compares the handoff latency and fairness of std::mutex, the spinlocks and
+// adaptive_mutex on 1-64 threads, which oversubscribes most machines.
+void spinlock_handoff()
+{
+    for (unsigned num_threads = 1; num_threads <= 64; num_threads *= 2)
+    {
+        lock_handoff_run<std::mutex>        ("std::mutex    ", num_threads);
+        lock_handoff_run<si::spinlock_mutex>("spinlock_mutex", num_threads);
+        lock_handoff_run<si::spinlock_amd>  ("spinlock_amd  ", num_threads);
+        lock_handoff_run<si::ticket_lock>   ("ticket_lock   ", num_threads);
+        lock_handoff_run<si::mcs_lock>      ("mcs_lock      ", num_threads);
+        lock_handoff_run<si::adaptive_mutex>("adaptive_mutex", num_threads);
+    }
+}
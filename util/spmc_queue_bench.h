@@ -0,0 +1,63 @@
+#pragma once
+
+#include <si_spmc_queue.h>
+
+#include <chrono>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+// One producer pushes num_values to num_consumers that pop until the queue
+// is closed. Reports the average time the producer spends in push.
+template <typename Queue>
+void spmc_push_cost_run(const std::string& name, Queue& q, unsigned num_consumers)
+{
+    using namespace std::chrono;
+    const long long num_values = 2000000;
+
+    std::vector<std::thread> consumers;
+    std::vector<long long> sums(num_consumers, 0);
+    for (unsigned c = 0; c < num_consumers; ++ c)
+        consumers.emplace_back([&q, &sums, c]() {
+            try
+            {
+                for (;;)
+                    sums[c] += q.pop();
+            }
+            catch (const std::runtime_error&)
+            {}
+        });
+
+    const auto start = steady_clock::now();
+    for (long long i = 0; i < num_values; ++ i)
+        q.push(i);
+    const double ns = duration_cast<duration<double, std::nano>>(steady_clock::now() - start).count();
+
+    q.close();
+    long long sum = 0;
+    for (unsigned c = 0; c < num_consumers; ++ c)
+    {
+        consumers[c].join();
+        sum += sums[c];
+    }
+    if (sum != num_values * (num_values - 1) / 2)
+        std::cout << "wrong sum " << sum << std::endl;
+
+    std::cout << name << "; consumers = " << num_consumers
+              << "; ns/push = " << ns / num_values << std::endl;
+}
+
+// Compares the producer push cost of spmc_fifo_queue and lockfree_spmc_queue.
+void spmc_queue_push_cost()
+{
+    const size_t capacity = 1024;
+    for (unsigned num_consumers : {1u, 4u, 16u})
+    {
+        si::spmc_fifo_queue<long long> locked(capacity);
+        spmc_push_cost_run("spmc_fifo_queue    ", locked, num_consumers);
+        si::lockfree_spmc_queue<long long> lockfree(capacity);
+        spmc_push_cost_run("lockfree_spmc_queue", lockfree, num_consumers);
+    }
+}
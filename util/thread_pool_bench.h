@@ -0,0 +1,129 @@
+#pragma once
+
+#include <si_thread_pool.h>
+#include <si_threadsafe_queue.h>
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+// What everybody used before thread_pool: one threadsafe_queue of
+// std::function behind a single lock.
+class locked_pool
+{
+public:
+    explicit locked_pool(unsigned num_threads)
+    {
+        for (unsigned i = 0; i < num_threads; ++ i)
+            d_threads.emplace_back([this]() {
+                std::function<void()> f;
+                while (d_queue.wait_and_pop(f))
+                    f();
+            });
+    }
+
+    ~locked_pool()
+    {
+        d_queue.close();
+        for (auto& t : d_threads)
+            t.join();
+    }
+
+    template <typename F>
+    void post(F&& f)
+    {
+        d_queue.push(std::forward<F>(f));
+    }
+
+private:
+    si::threadsafe_queue<std::function<void()>> d_queue;
+    std::vector<std::thread>                    d_threads;
+};
+
+// Tiny tasks that only bump a counter.
+// external: the main thread posts all of them.
+// recursive: each task posts two children, a binary tree of tasks.
+template <typename Pool>
+struct tiny_tasks
+{
+    Pool&             pool;
+    std::atomic<long> done{0};
+
+    void external(long num_tasks)
+    {
+        for (long i = 0; i < num_tasks; ++ i)
+            pool.post([this]() { done.fetch_add(1, std::memory_order_relaxed); });
+    }
+
+    void recursive(int depth)
+    {
+        if (depth > 0)
+        {
+            pool.post([this, depth]() { recursive(depth - 1); });
+            pool.post([this, depth]() { recursive(depth - 1); });
+        }
+        done.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void wait(long num_tasks)
+    {
+        while (done.load(std::memory_order_relaxed) != num_tasks)
+            std::this_thread::yield();
+    }
+};
+
+template <typename Pool>
+void thread_pool_tiny_tasks_run(const std::string& name, unsigned num_threads)
+{
+    using namespace std::chrono;
+    const long num_external = 1 << 20;
+    const int depth = 19;
+    const long num_recursive = (1L << (depth + 1)) - 1;
+
+    Pool pool(num_threads);
+    {
+        tiny_tasks<Pool> tasks{pool};
+        const auto start = steady_clock::now();
+        tasks.external(num_external);
+        tasks.wait(num_external);
+        const double secs = duration_cast<duration<double>>(steady_clock::now() - start).count();
+        std::cout << name << "; threads = " << num_threads
+                  << "; external Mtasks/s = " << num_external / secs / 1E6;
+    }
+    {
+        tiny_tasks<Pool> tasks{pool};
+        const auto start = steady_clock::now();
+        pool.post([&tasks, depth]() { tasks.recursive(depth); });
+        tasks.wait(num_recursive);
+        const double secs = duration_cast<duration<double>>(steady_clock::now() - start).count();
+        std::cout << "; recursive Mtasks/s = " << num_recursive / secs / 1E6 << std::endl;
+    }
+}
+
+// Compares the tiny task throughput of thread_pool with a single locked
+// queue on 1-64 threads, and the scaling of parallel_for.
+void thread_pool_tiny_tasks()
+{
+    using namespace std::chrono;
+    for (unsigned num_threads = 1; num_threads <= 64; num_threads *= 2)
+    {
+        thread_pool_tiny_tasks_run<locked_pool>    ("locked_pool", num_threads);
+        thread_pool_tiny_tasks_run<si::thread_pool>("thread_pool", num_threads);
+    }
+
+    const size_t n = 1 << 26;
+    std::vector<unsigned> v(n);
+    for (unsigned num_threads = 1; num_threads <= 64; num_threads *= 2)
+    {
+        si::thread_pool pool(num_threads);
+        const auto start = steady_clock::now();
+        pool.parallel_for(0, n, [&v](size_t i) { v[i] = static_cast<unsigned>(i * 2654435761u); });
+        const double secs = duration_cast<duration<double>>(steady_clock::now() - start).count();
+        std::cout << "parallel_for; threads = " << num_threads
+                  << "; Mindices/s = " << n / secs / 1E6 << std::endl;
+    }
+}
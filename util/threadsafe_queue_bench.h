@@ -0,0 +1,178 @@
+#pragma once
+
+#include <si_threadsafe_queue.h>
+#include <si_two_lock_queue.h>
+
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+// One consumer draining messages from num_producers producers, either one
+// message per lock acquisition or in batches.
+template <bool Batched>
+void queue_batching_run(unsigned num_producers, long long per_producer)
+{
+    using namespace std::chrono;
+    const size_t batch_size = 64;
+    si::threadsafe_queue<std::string> q;
+
+    const auto start = steady_clock::now();
+    std::vector<std::thread> producers;
+    for (unsigned p = 0; p < num_producers; ++ p)
+        producers.emplace_back([&q, per_producer]() {
+            std::vector<std::string> batch;
+            for (long long i = 0; i < per_producer; ++ i)
+            {
+                if (!Batched)
+                {
+                    q.push(std::string("log message"));
+                    continue;
+                }
+
+                batch.emplace_back("log message");
+                if (batch.size() == batch_size || i + 1 == per_producer)
+                {
+                    q.push_bulk(batch.begin(), batch.end());
+                    batch.clear();
+                }
+            }
+        });
+
+    const long long total = per_producer * num_producers;
+    long long consumed = 0;
+    long long pops = 0;
+    std::vector<std::string> out;
+    std::string msg;
+    while (consumed < total)
+    {
+        ++ pops;
+        if (Batched)
+        {
+            out.clear();
+            consumed += q.wait_and_pop_all(out);
+        }
+        else
+        {
+            q.wait_and_pop(msg);
+            ++ consumed;
+        }
+    }
+
+    for (auto& t : producers)
+        t.join();
+    const double secs = duration_cast<duration<double>>(steady_clock::now() - start).count();
+
+    std::cout << (Batched ? "push_bulk/pop_all" : "push/wait_and_pop")
+              << "; producers = " << num_producers
+              << "; Mmsgs/s = " << total / secs / 1E6
+              << "; consumer pops = " << pops << std::endl;
+}
+
+void threadsafe_queue_batching()
+{
+    for (unsigned num_producers = 1; num_producers <= 8; num_producers *= 2)
+    {
+        queue_batching_run<false>(num_producers, 2000000 / num_producers);
+        queue_batching_run<true> (num_producers, 2000000 / num_producers);
+    }
+}
+
+// A producer pushes 1KB messages much faster than the consumer pops them.
+// Each configuration runs in a child process to report its own peak memory.
+void queue_overload_run(size_t capacity, long long num_msgs)
+{
+    std::cout.flush();
+    if (fork() == 0)
+    {
+        using namespace std::chrono;
+        si::threadsafe_queue<std::string> q = capacity ? si::threadsafe_queue<std::string>(capacity)
+                                                       : si::threadsafe_queue<std::string>();
+        const auto start = steady_clock::now();
+        std::thread producer([&q, num_msgs]() {
+            for (long long i = 0; i < num_msgs; ++ i)
+                q.push(std::string(1024, 'x'));
+            q.close();
+        });
+
+        // Simulate a slow consumer
+        std::string msg;
+        long long consumed = 0;
+        while (q.wait_and_pop(msg))
+        {
+            ++ consumed;
+            if (consumed % 64 == 0)
+                std::this_thread::sleep_for(microseconds(50));
+        }
+
+        producer.join();
+        const double secs = duration_cast<duration<double>>(steady_clock::now() - start).count();
+
+        rusage usage;
+        getrusage(RUSAGE_SELF, &usage);
+        std::cout << (capacity ? "bounded  " : "unbounded")
+                  << "; capacity = " << capacity
+                  << "; Kmsgs/s = " << consumed / secs / 1E3
+                  << "; peak rss = " << usage.ru_maxrss << " KB" << std::endl;
+        _exit(0);
+    }
+
+    int status;
+    wait(&status);
+}
+
+// Compares peak memory of an unbounded and a bounded queue with a slow consumer.
+void threadsafe_queue_overload()
+{
+    const long long num_msgs = 500000;
+    queue_overload_run(0, num_msgs);
+    for (size_t capacity = 64; capacity <= 4096; capacity *= 8)
+        queue_overload_run(capacity, num_msgs);
+}
+
+// num_threads producers and num_threads consumers, returns Mmsgs/s.
+template <class Queue>
+double queue_mpmc_throughput(unsigned num_threads, long long per_thread)
+{
+    using namespace std::chrono;
+    Queue q;
+    std::vector<std::thread> threads;
+    const auto start = steady_clock::now();
+    for (unsigned t = 0; t < num_threads; ++ t)
+    {
+        threads.emplace_back([&q, per_thread]() {
+            for (long long i = 0; i < per_thread; ++ i)
+                q.push(i);
+        });
+        threads.emplace_back([&q, per_thread]() {
+            long long val;
+            for (long long i = 0; i < per_thread; ++ i)
+                q.wait_and_pop(val);
+        });
+    }
+
+    for (auto& t : threads)
+        t.join();
+    const double secs = duration_cast<duration<double>>(steady_clock::now() - start).count();
+    return per_thread * num_threads / secs / 1E6;
+}
+
+// Compares the single lock threadsafe_queue with the two_lock_queue.
+void two_lock_queue_mpmc()
+{
+    for (unsigned num_threads = 1; num_threads <= 8; num_threads *= 2)
+    {
+        const long long per_thread = 2000000 / num_threads;
+        std::cout << "producers = consumers = " << num_threads
+                  << "; threadsafe_queue Mmsgs/s = "
+                  << queue_mpmc_throughput<si::threadsafe_queue<long long>>(num_threads, per_thread)
+                  << "; two_lock_queue Mmsgs/s = "
+                  << queue_mpmc_throughput<si::two_lock_queue<long long>>(num_threads, per_thread)
+                  << std::endl;
+    }
+}
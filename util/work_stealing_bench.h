@@ -0,0 +1,156 @@
+#pragma once
+
+#include <si_threadsafe_stack.h>
+#include <si_work_stealing_deque.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <optional>
+#include <random>
+#include <thread>
+#include <vector>
+
+// A fork/join job: sum f(i) over a range. Tasks bigger than the grain are
+// split in two, one half is handed to the pool and the other one is split
+// again. Each configuration returns the sum to check it against the others.
+struct range_task
+{
+    uint32_t begin;
+    uint32_t end;
+};
+
+constexpr uint32_t range_task_size = 1 << 24;
+constexpr uint32_t range_task_grain = 256;
+
+inline uint64_t range_task_run(range_task task)
+{
+    uint64_t sum = 0;
+    for (uint32_t i = task.begin; i != task.end; ++ i)
+        sum += (i * 2654435761u) >> 7;
+    return sum;
+}
+
+// Splits task until it's small enough, handing the upper halves to spawn.
+template <typename Spawn>
+range_task range_task_split(range_task task, Spawn spawn)
+{
+    while (task.end - task.begin > range_task_grain)
+    {
+        const uint32_t mid = task.begin + (task.end - task.begin) / 2;
+        spawn(range_task{mid, task.end});
+        task.end = mid;
+    }
+    return task;
+}
+
+// Every worker owns a deque and steals from random victims when it runs dry.
+uint64_t work_stealing_run(unsigned num_threads, long long& steals)
+{
+    std::vector<std::unique_ptr<si::work_stealing_deque<range_task>>> deques;
+    for (unsigned i = 0; i < num_threads; ++ i)
+        deques.push_back(std::make_unique<si::work_stealing_deque<range_task>>());
+    deques[0]->push(range_task{0, range_task_size});
+
+    std::atomic<uint64_t> remaining{range_task_size};
+    std::atomic<uint64_t> total{0};
+    std::atomic<long long> total_steals{0};
+    std::vector<std::thread> threads;
+    for (unsigned w = 0; w < num_threads; ++ w)
+        threads.emplace_back([&, w]() {
+            si::work_stealing_deque<range_task>& own = *deques[w];
+            std::minstd_rand rng(w);
+            uint64_t sum = 0;
+            long long stolen = 0;
+            while (remaining.load(std::memory_order_relaxed) != 0)
+            {
+                std::optional<range_task> task = own.pop();
+                if (!task && num_threads > 1)
+                {
+                    const unsigned victim = rng() % num_threads;
+                    if (victim != w && (task = deques[victim]->steal()))
+                        ++ stolen;
+                }
+                if (!task)
+                {
+                    std::this_thread::yield();
+                    continue;
+                }
+
+                const range_task leaf = range_task_split(*task, [&own](range_task t) { own.push(t); });
+                sum += range_task_run(leaf);
+                remaining.fetch_sub(leaf.end - leaf.begin, std::memory_order_relaxed);
+            }
+            total += sum;
+            total_steals += stolen;
+        });
+
+    for (auto& t : threads)
+        t.join();
+    steals = total_steals;
+    return total;
+}
+
+// All the workers share a single threadsafe_stack as the task pool.
+uint64_t shared_stack_run(unsigned num_threads)
+{
+    si::threadsafe_stack<range_task> pool;
+    pool.push(range_task{0, range_task_size});
+
+    std::atomic<uint64_t> remaining{range_task_size};
+    std::atomic<uint64_t> total{0};
+    std::vector<std::thread> threads;
+    for (unsigned w = 0; w < num_threads; ++ w)
+        threads.emplace_back([&]() {
+            uint64_t sum = 0;
+            range_task task;
+            while (remaining.load(std::memory_order_relaxed) != 0)
+            {
+                if (!pool.try_pop(task))
+                {
+                    std::this_thread::yield();
+                    continue;
+                }
+
+                const range_task leaf = range_task_split(task, [&pool](range_task t) { pool.push(t); });
+                sum += range_task_run(leaf);
+                remaining.fetch_sub(leaf.end - leaf.begin, std::memory_order_relaxed);
+            }
+            total += sum;
+        });
+
+    for (auto& t : threads)
+        t.join();
+    return total;
+}
+
+// Compares the throughput of work_stealing_deque per worker with a shared
+// threadsafe_stack on a fork/join job, and reports how often workers steal.
+void work_stealing_deque_throughput()
+{
+    using namespace std::chrono;
+    // Every task ends with one leaf
+    const double num_tasks = range_task_size / range_task_grain;
+    const uint64_t expected = range_task_run(range_task{0, range_task_size});
+
+    for (unsigned num_threads = 1; num_threads <= 16; num_threads *= 2)
+    {
+        long long steals = 0;
+        auto start = steady_clock::now();
+        const uint64_t ws = work_stealing_run(num_threads, steals);
+        const double ws_secs = duration_cast<duration<double>>(steady_clock::now() - start).count();
+
+        start = steady_clock::now();
+        const uint64_t ts = shared_stack_run(num_threads);
+        const double ts_secs = duration_cast<duration<double>>(steady_clock::now() - start).count();
+
+        if (ws != expected || ts != expected)
+            std::cout << "wrong sum" << std::endl;
+        std::cout << "threads = " << num_threads
+                  << "; work_stealing_deque Mtasks/s = " << num_tasks / ws_secs / 1E6
+                  << " (steals = " << 100.0 * steals / num_tasks << "%)"
+                  << "; threadsafe_stack Mtasks/s = " << num_tasks / ts_secs / 1E6 << std::endl;
+    }
+}